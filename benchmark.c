@@ -0,0 +1,2400 @@
+/*
+* Benchmark for mazelib.
+*
+* Like example.c, this is a single file which can be compiled on its own, for example:
+* cc -O2 -o benchmark benchmark.c -lm -lpthread
+*
+* It sweeps a number of maze sizes, cell selection policies and output formats, and reports the time taken per cell along with its variance.
+* Results are written as a human readable table, as CSV or as JSON, so that they can be compared between versions of the library.
+*
+* On Linux, --perf additionally collects hardware counters through perf_event_open for every scenario,
+* and reports cycles, instructions, branch misses, L1 data cache, last level cache and data TLB misses per cell.
+* Counters the kernel or the CPU does not provide are reported as unavailable rather than failing the run.
+* Only user space events are counted, so this works with the default perf_event_paranoid setting of 2.
+*
+* --trace writes a timeline of every generated maze and of the phases inside the library (clear, carve and blockwise conversion) to a file,
+* in the Chrome trace event format, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+* The events are kept in a fixed size ring buffer, so only the most recent ones are written for long runs.
+* It works by defining the library's MAZELIB_TRACE_BEGIN and MAZELIB_TRACE_END hooks, which are empty unless defined like this.
+*
+* --verify checks the library against a golden corpus instead of measuring it.
+* The corpus holds FNV-1a hashes of compact and blockwise mazes for a grid of sizes, seeds and thresholds, recorded with version 1.0 of the library.
+* Every path that produces a maze (mazelib_generate, mazelib_generate_extended, mazelib_convert_to_blockwise and mazelib_convert_columns_to_blockwise) must reproduce them exactly,
+* so that optimizations can not silently change the mazes generated for existing seeds.
+* Compile it once more with -DMAZELIB_NO_SIMD and run --verify again to check the portable code as well as the kernels selected for this CPU.
+* If the output of the library is changed on purpose, --print-corpus prints a new table to paste over the old one.
+* It also checks that mazes with 10 or 12 random waypoints on mid-size grids are generated, and that their solution passes the waypoints in order.
+*
+* --scaling measures how throughput changes from 1 to N threads, for four workloads:
+* batch generation of many small mazes, each thread with its own buffer,
+* conversion of one large maze to the blockwise format, with each thread converting its own band of columns (see mazelib_convert_columns_to_blockwise),
+* labelling the components of the same maze, with each thread labelling its own band of columns followed by a single threaded merge (see mazelib_label_component_band),
+* and a STREAM style triad over arrays much larger than the caches, which shows the memory bandwidth of the host.
+* Every workload reports speedup and efficiency relative to one thread, and bytes per second as a fraction of the triad bandwidth with the same number of threads,
+* so it is easy to see where a workload stops scaling because it has run out of memory bandwidth.
+*
+* --prng measures the random number generator on its own: mazelib_prng_next, mazelib_prng_next_in_range with small, odd and huge ranges
+* (along with how often the range reduction has to throw a number away), the four element direction shuffle and the high level cell selection.
+* It also reports how many random numbers are drawn per cell of a maze for each threshold.
+* Those counts come from mazelib_stats when the benchmark is compiled with -DMAZELIB_STATS, and are otherwise derived from the structure of the algorithm.
+*
+* Run it with --help for the list of options.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+/* The tracer is declared before the library is included, so that the phase hooks can call it. */
+static void benchmark_trace_begin ( const char* name );
+static void benchmark_trace_end ( void );
+#define MAZELIB_TRACE_BEGIN(phase) benchmark_trace_begin ( phase )
+#define MAZELIB_TRACE_END(phase) benchmark_trace_end ()
+
+#define MAZELIB_IMPLEMENTATION
+#include "mazelib.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+/* TIMING */
+
+static uint64_t benchmark_now_ns ( void )
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter ( &counter );
+    QueryPerformanceFrequency ( &frequency );
+    return ( uint64_t ) ( ( double ) counter.QuadPart * 1000000000.0 / ( double ) frequency.QuadPart );
+#else
+    struct timespec now;
+    clock_gettime ( CLOCK_MONOTONIC, &now );
+    return ( uint64_t ) now.tv_sec * 1000000000u + ( uint64_t ) now.tv_nsec;
+#endif
+}
+
+/* Pin the calling thread to a single CPU so that it is not migrated while being measured. Returns 0 on failure. */
+static int benchmark_pin_thread ( int cpu )
+{
+#if defined(_WIN32)
+    return SetThreadAffinityMask ( GetCurrentThread (), ( DWORD_PTR ) 1 << cpu ) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO ( &set );
+    CPU_SET ( cpu, &set );
+    return sched_setaffinity ( 0, sizeof ( set ), &set ) == 0;
+#else
+    ( void ) cpu;
+    return 0;
+#endif
+}
+
+/* TRACING */
+
+#define BENCHMARK_TRACE_CAPACITY 65536
+#define BENCHMARK_TRACE_DEPTH 8
+
+/* A completed span. Events for whole jobs carry the parameters of the maze, library phases leave them at 0. */
+typedef struct benchmark_trace_event benchmark_trace_event;
+struct benchmark_trace_event
+{
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t width;
+    uint32_t height;
+    int threshold;
+    int blockwise;
+    int job;
+};
+
+typedef struct benchmark_tracer benchmark_tracer;
+struct benchmark_tracer
+{
+    int enabled;
+    uint64_t origin_ns;
+    uint64_t recorded; /* The total number of events, the ring holds the last BENCHMARK_TRACE_CAPACITY of them. */
+    benchmark_trace_event events[BENCHMARK_TRACE_CAPACITY];
+    benchmark_trace_event open[BENCHMARK_TRACE_DEPTH];
+    unsigned int depth;
+};
+
+static benchmark_tracer benchmark_trace;
+
+static void benchmark_trace_push ( const char* name, uint32_t width, uint32_t height, int threshold, int blockwise, int job )
+{
+    benchmark_trace_event* event;
+
+    if ( !benchmark_trace.enabled || benchmark_trace.depth == BENCHMARK_TRACE_DEPTH )
+    {
+        return;
+    }
+    event = &benchmark_trace.open[benchmark_trace.depth++];
+    event->name = name;
+    event->width = width;
+    event->height = height;
+    event->threshold = threshold;
+    event->blockwise = blockwise;
+    event->job = job;
+    event->start_ns = benchmark_now_ns ();
+}
+
+static void benchmark_trace_begin ( const char* name )
+{
+    benchmark_trace_push ( name, 0, 0, 0, 0, 0 );
+}
+
+static void benchmark_trace_end ( void )
+{
+    benchmark_trace_event* event;
+
+    if ( !benchmark_trace.enabled || benchmark_trace.depth == 0 )
+    {
+        return;
+    }
+    event = &benchmark_trace.open[--benchmark_trace.depth];
+    event->duration_ns = benchmark_now_ns () - event->start_ns;
+    benchmark_trace.events[benchmark_trace.recorded++ % BENCHMARK_TRACE_CAPACITY] = *event;
+}
+
+static void benchmark_trace_start ( void )
+{
+    benchmark_trace.enabled = 1;
+    benchmark_trace.origin_ns = benchmark_now_ns ();
+}
+
+/* Write the events in the ring to path in the Chrome trace event format, as complete ("X") events with microsecond timestamps. */
+static int benchmark_trace_dump ( const char* path )
+{
+    const uint64_t count = benchmark_trace.recorded < BENCHMARK_TRACE_CAPACITY ? benchmark_trace.recorded : BENCHMARK_TRACE_CAPACITY;
+    const uint64_t first = benchmark_trace.recorded - count;
+    FILE* out = fopen ( path, "w" );
+    uint64_t i;
+
+    if ( out == NULL )
+    {
+        return 0;
+    }
+    fprintf ( out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": %llu}, \"traceEvents\": [", ( unsigned long long ) first );
+    for ( i = first; i < benchmark_trace.recorded; ++i )
+    {
+        const benchmark_trace_event* event = &benchmark_trace.events[i % BENCHMARK_TRACE_CAPACITY];
+        fprintf ( out, "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f",
+                  i == first ? "" : ",", event->name, event->job ? "job" : "mazelib", ( double ) ( event->start_ns - benchmark_trace.origin_ns ) / 1000.0, ( double ) event->duration_ns / 1000.0 );
+        if ( event->job )
+        {
+            fprintf ( out, ", \"args\": {\"width\": %u, \"height\": %u, \"threshold\": %d, \"format\": \"%s\"}",
+                      event->width, event->height, event->threshold, event->blockwise ? "blockwise" : "compact" );
+        }
+        fprintf ( out, "}" );
+    }
+    fprintf ( out, "\n]}\n" );
+    return fclose ( out ) == 0;
+}
+
+/* HARDWARE COUNTERS */
+
+#define BENCHMARK_COUNTER_COUNT 6
+
+static const char* const benchmark_counter_names[BENCHMARK_COUNTER_COUNT] =
+{
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses"
+};
+
+/* A file descriptor of -1 means that the counter could not be opened. */
+typedef struct benchmark_counters benchmark_counters;
+struct benchmark_counters
+{
+    int fds[BENCHMARK_COUNTER_COUNT];
+};
+
+#if defined(__linux__)
+
+static int benchmark_open_counter ( uint32_t type, uint64_t config )
+{
+    struct perf_event_attr attr;
+
+    memset ( &attr, 0, sizeof ( attr ) );
+    attr.size = sizeof ( attr );
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return ( int ) syscall ( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+/*
+* The counters are opened individually rather than as a group, so that a CPU with fewer programmable counters than we ask for still reports all of them.
+* The kernel then multiplexes them, and the values are scaled by the fraction of time each one was actually running.
+*/
+static int benchmark_open_counters ( benchmark_counters* counters )
+{
+    const uint64_t read_miss = ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+    unsigned int i;
+    int opened = 0;
+
+    counters->fds[0] = benchmark_open_counter ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+    counters->fds[1] = benchmark_open_counter ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+    counters->fds[2] = benchmark_open_counter ( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES );
+    counters->fds[3] = benchmark_open_counter ( PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss );
+    counters->fds[4] = benchmark_open_counter ( PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss );
+    counters->fds[5] = benchmark_open_counter ( PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss );
+    for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+    {
+        if ( counters->fds[i] >= 0 )
+        {
+            ++opened;
+        }
+        else
+        {
+            fprintf ( stderr, "Warning: the %s counter is not available.\n", benchmark_counter_names[i] );
+        }
+    }
+    return opened;
+}
+
+static void benchmark_close_counters ( benchmark_counters* counters )
+{
+    unsigned int i;
+    for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+    {
+        if ( counters->fds[i] >= 0 )
+        {
+            close ( counters->fds[i] );
+            counters->fds[i] = -1;
+        }
+    }
+}
+
+static void benchmark_start_counters ( const benchmark_counters* counters )
+{
+    unsigned int i;
+    for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+    {
+        if ( counters->fds[i] >= 0 )
+        {
+            ioctl ( counters->fds[i], PERF_EVENT_IOC_RESET, 0 );
+            ioctl ( counters->fds[i], PERF_EVENT_IOC_ENABLE, 0 );
+        }
+    }
+}
+
+/* Stop the counters and store their scaled totals in values. Unavailable counters are stored as -1. */
+static void benchmark_stop_counters ( const benchmark_counters* counters, double* values )
+{
+    unsigned int i;
+    for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+    {
+        uint64_t data[3];
+        values[i] = -1.0;
+        if ( counters->fds[i] < 0 )
+        {
+            continue;
+        }
+        ioctl ( counters->fds[i], PERF_EVENT_IOC_DISABLE, 0 );
+        if ( read ( counters->fds[i], data, sizeof ( data ) ) == ( ssize_t ) sizeof ( data ) && data[2] != 0 )
+        {
+            values[i] = ( double ) data[0] * ( ( double ) data[1] / ( double ) data[2] );
+        }
+    }
+}
+
+#else
+
+static int benchmark_open_counters ( benchmark_counters* counters )
+{
+    unsigned int i;
+    for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+    {
+        counters->fds[i] = -1;
+    }
+    return 0;
+}
+
+static void benchmark_close_counters ( benchmark_counters* counters )
+{
+    ( void ) counters;
+}
+
+static void benchmark_start_counters ( const benchmark_counters* counters )
+{
+    ( void ) counters;
+}
+
+static void benchmark_stop_counters ( const benchmark_counters* counters, double* values )
+{
+    unsigned int i;
+    ( void ) counters;
+    for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+    {
+        values[i] = -1.0;
+    }
+}
+
+#endif
+
+/* POLICIES */
+
+static uint64_t benchmark_newest_callback ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    ( void ) prng;
+    ( void ) user;
+    return count - 1;
+}
+
+static uint64_t benchmark_random_callback ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    ( void ) user;
+    return mazelib_prng_next_in_range ( prng, count );
+}
+
+/*
+* A policy is either one of the thresholds of the high level API (callback is NULL),
+* or a custom callback which is passed to the low level API.
+*/
+typedef struct benchmark_policy benchmark_policy;
+struct benchmark_policy
+{
+    const char* name;
+    int8_t threshold;
+    mazelib_cell_selection_callback callback;
+};
+
+static const benchmark_policy benchmark_policies[] =
+{
+    { "threshold", 0, NULL },
+    { "threshold", 25, NULL },
+    { "threshold", 50, NULL },
+    { "threshold", 100, NULL },
+    { "callback_newest", -1, benchmark_newest_callback },
+    { "callback_random", -1, benchmark_random_callback }
+};
+
+#define BENCHMARK_POLICY_COUNT ( sizeof ( benchmark_policies ) / sizeof ( benchmark_policies[0] ) )
+
+static const uint32_t benchmark_default_sizes[] = { 8, 32, 128, 512, 1024, 2048, 4096, 16384 };
+
+#define BENCHMARK_DEFAULT_SIZE_COUNT ( sizeof ( benchmark_default_sizes ) / sizeof ( benchmark_default_sizes[0] ) )
+#define BENCHMARK_MAX_SIZES 32
+
+/* OPTIONS */
+
+typedef enum benchmark_mode
+{
+    benchmark_mode_sweep,
+    benchmark_mode_scaling,
+    benchmark_mode_prng,
+    benchmark_mode_verify,
+    benchmark_mode_print_corpus
+} benchmark_mode;
+
+typedef enum benchmark_format
+{
+    benchmark_format_text,
+    benchmark_format_csv,
+    benchmark_format_json
+} benchmark_format;
+
+typedef struct benchmark_options benchmark_options;
+struct benchmark_options
+{
+    benchmark_mode mode;
+    uint32_t sizes[BENCHMARK_MAX_SIZES];
+    unsigned int size_count;
+    uint64_t max_cells;
+    uint64_t seed;
+    unsigned int min_repetitions;
+    double min_seconds;
+    int cpu;
+    int compact;
+    int blockwise;
+    int policy_mask;
+    int perf;
+    benchmark_format format;
+    const char* output_path;
+    const char* trace_path;
+    unsigned int max_threads;
+    uint32_t batch_size;
+    uint32_t batch_count;
+    uint32_t convert_size;
+    uint32_t stream_megabytes;
+};
+
+typedef struct benchmark_result benchmark_result;
+struct benchmark_result
+{
+    uint32_t width;
+    uint32_t height;
+    uint8_t blockwise;
+    const benchmark_policy* policy;
+    unsigned int repetitions;
+    double mean_ns;
+    double min_ns;
+    double max_ns;
+    double stddev_ns;
+    uint64_t output_bytes;
+    uint64_t scratch_bytes;
+    /* Hardware counters per cell, or -1 if unavailable. Only filled in when --perf is given. */
+    double counters_per_cell[BENCHMARK_COUNTER_COUNT];
+};
+
+static void benchmark_print_usage ( void )
+{
+    printf ( "Usage: benchmark [options]\n"
+             "  --scaling           Measure throughput from 1 to --threads threads instead of sweeping sizes.\n"
+             "  --threads n         The largest number of threads for --scaling (default: the number of online CPUs).\n"
+             "  --batch-size n      Size of the mazes generated in the batch workload of --scaling (default 128).\n"
+             "  --batch-count n     Number of mazes in the batch workload of --scaling (default 256).\n"
+             "  --convert-size n    Size of the maze converted in the conversion workload of --scaling (default 4096).\n"
+             "  --stream-mb n       Size of each of the three arrays of the bandwidth baseline, in megabytes (default 128).\n"
+             "  --prng              Measure the random number generator, range reduction and shuffle in isolation.\n"
+             "  --verify            Check every generation path against the golden corpus instead of measuring.\n"
+             "  --print-corpus      Print a new golden corpus table generated by the current library.\n"
+             "  --sizes a,b,c       Square maze sizes to sweep (default 8,32,128,512,1024,2048,4096,16384).\n"
+             "  --max-cells n       Skip mazes with more than n cells (default 1048576). Random selection is quadratic in the frontier size,\n"
+             "                      so large mazes with a nonzero threshold take a long time. 16384x16384 needs 268435456 and several GB of memory.\n"
+             "  --policies list     Comma separated subset of t0,t25,t50,t100,newest,random (default all).\n"
+             "  --compact-only      Only generate compact mazes.\n"
+             "  --blockwise-only    Only generate blockwise mazes.\n"
+             "  --repeat n          Minimum number of timed repetitions per scenario (default 5).\n"
+             "  --min-time s        Keep repeating until this many seconds have been spent on a scenario (default 0.2).\n"
+             "  --seed n            Seed used for every repetition (default 1).\n"
+             "  --cpu n             Pin the benchmark to CPU n (default 0, -1 to disable).\n"
+             "  --perf              Collect hardware counters per cell with perf_event_open (Linux only).\n"
+             "  --format f          text, csv or json (default text).\n"
+             "  --output path       Write the results to a file instead of standard output.\n"
+             "  --trace path        Write a Chrome trace of the most recent jobs and library phases to a file.\n" );
+}
+
+static int benchmark_parse_sizes ( const char* text, benchmark_options* options )
+{
+    options->size_count = 0;
+    while ( *text )
+    {
+        char* end;
+        unsigned long value = strtoul ( text, &end, 10 );
+        if ( end == text || value == 0 || value > 0xffffffffu || options->size_count == BENCHMARK_MAX_SIZES )
+        {
+            return 0;
+        }
+        options->sizes[options->size_count++] = ( uint32_t ) value;
+        text = *end == ',' ? end + 1 : end;
+        if ( *end && *end != ',' )
+        {
+            return 0;
+        }
+    }
+    return options->size_count > 0;
+}
+
+static int benchmark_parse_policies ( const char* text, benchmark_options* options )
+{
+    static const char* const names[] = { "t0", "t25", "t50", "t100", "newest", "random" };
+    options->policy_mask = 0;
+    while ( *text )
+    {
+        size_t length = strcspn ( text, "," );
+        unsigned int i;
+        for ( i = 0; i < BENCHMARK_POLICY_COUNT; ++i )
+        {
+            if ( strlen ( names[i] ) == length && strncmp ( names[i], text, length ) == 0 )
+            {
+                options->policy_mask |= 1 << i;
+                break;
+            }
+        }
+        if ( i == BENCHMARK_POLICY_COUNT )
+        {
+            return 0;
+        }
+        text += length;
+        if ( *text == ',' )
+        {
+            ++text;
+        }
+    }
+    return options->policy_mask != 0;
+}
+
+static int benchmark_parse_options ( int argc, char** argv, benchmark_options* options )
+{
+    int i;
+
+    options->mode = benchmark_mode_sweep;
+    memcpy ( options->sizes, benchmark_default_sizes, sizeof ( benchmark_default_sizes ) );
+    options->size_count = BENCHMARK_DEFAULT_SIZE_COUNT;
+    options->max_cells = 1048576;
+    options->seed = 1;
+    options->min_repetitions = 5;
+    options->min_seconds = 0.2;
+    options->cpu = 0;
+    options->compact = 1;
+    options->blockwise = 1;
+    options->policy_mask = ( 1 << BENCHMARK_POLICY_COUNT ) - 1;
+    options->perf = 0;
+    options->format = benchmark_format_text;
+    options->output_path = NULL;
+    options->trace_path = NULL;
+    options->max_threads = 0;
+    options->batch_size = 128;
+    options->batch_count = 256;
+    options->convert_size = 4096;
+    options->stream_megabytes = 128;
+
+    for ( i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if ( strcmp ( arg, "--help" ) == 0 )
+        {
+            benchmark_print_usage ();
+            exit ( 0 );
+        }
+        else if ( strcmp ( arg, "--compact-only" ) == 0 )
+        {
+            options->blockwise = 0;
+            continue;
+        }
+        else if ( strcmp ( arg, "--blockwise-only" ) == 0 )
+        {
+            options->compact = 0;
+            continue;
+        }
+        else if ( strcmp ( arg, "--perf" ) == 0 )
+        {
+            options->perf = 1;
+            continue;
+        }
+        else if ( strcmp ( arg, "--scaling" ) == 0 )
+        {
+            options->mode = benchmark_mode_scaling;
+            continue;
+        }
+        else if ( strcmp ( arg, "--prng" ) == 0 )
+        {
+            options->mode = benchmark_mode_prng;
+            continue;
+        }
+        else if ( strcmp ( arg, "--verify" ) == 0 )
+        {
+            options->mode = benchmark_mode_verify;
+            continue;
+        }
+        else if ( strcmp ( arg, "--print-corpus" ) == 0 )
+        {
+            options->mode = benchmark_mode_print_corpus;
+            continue;
+        }
+        if ( value == NULL )
+        {
+            fprintf ( stderr, "Unknown option or missing value: %s\n", arg );
+            return 0;
+        }
+        ++i;
+        if ( strcmp ( arg, "--sizes" ) == 0 )
+        {
+            if ( !benchmark_parse_sizes ( value, options ) )
+            {
+                fprintf ( stderr, "Invalid size list: %s\n", value );
+                return 0;
+            }
+        }
+        else if ( strcmp ( arg, "--policies" ) == 0 )
+        {
+            if ( !benchmark_parse_policies ( value, options ) )
+            {
+                fprintf ( stderr, "Invalid policy list: %s\n", value );
+                return 0;
+            }
+        }
+        else if ( strcmp ( arg, "--max-cells" ) == 0 )
+        {
+            options->max_cells = strtoull ( value, NULL, 10 );
+        }
+        else if ( strcmp ( arg, "--repeat" ) == 0 )
+        {
+            options->min_repetitions = ( unsigned int ) strtoul ( value, NULL, 10 );
+            if ( options->min_repetitions == 0 )
+            {
+                options->min_repetitions = 1;
+            }
+        }
+        else if ( strcmp ( arg, "--min-time" ) == 0 )
+        {
+            options->min_seconds = atof ( value );
+        }
+        else if ( strcmp ( arg, "--seed" ) == 0 )
+        {
+            options->seed = strtoull ( value, NULL, 10 );
+        }
+        else if ( strcmp ( arg, "--cpu" ) == 0 )
+        {
+            options->cpu = atoi ( value );
+        }
+        else if ( strcmp ( arg, "--format" ) == 0 )
+        {
+            if ( strcmp ( value, "text" ) == 0 )
+            {
+                options->format = benchmark_format_text;
+            }
+            else if ( strcmp ( value, "csv" ) == 0 )
+            {
+                options->format = benchmark_format_csv;
+            }
+            else if ( strcmp ( value, "json" ) == 0 )
+            {
+                options->format = benchmark_format_json;
+            }
+            else
+            {
+                fprintf ( stderr, "Unknown format: %s\n", value );
+                return 0;
+            }
+        }
+        else if ( strcmp ( arg, "--output" ) == 0 )
+        {
+            options->output_path = value;
+        }
+        else if ( strcmp ( arg, "--trace" ) == 0 )
+        {
+            options->trace_path = value;
+        }
+        else if ( strcmp ( arg, "--threads" ) == 0 )
+        {
+            options->max_threads = ( unsigned int ) strtoul ( value, NULL, 10 );
+        }
+        else if ( strcmp ( arg, "--batch-size" ) == 0 || strcmp ( arg, "--batch-count" ) == 0 || strcmp ( arg, "--convert-size" ) == 0 || strcmp ( arg, "--stream-mb" ) == 0 )
+        {
+            const unsigned long number = strtoul ( value, NULL, 10 );
+            if ( number == 0 || number > 0xffffffffu )
+            {
+                fprintf ( stderr, "Invalid value for %s: %s\n", arg, value );
+                return 0;
+            }
+            if ( strcmp ( arg, "--batch-size" ) == 0 )
+            {
+                options->batch_size = ( uint32_t ) number;
+            }
+            else if ( strcmp ( arg, "--batch-count" ) == 0 )
+            {
+                options->batch_count = ( uint32_t ) number;
+            }
+            else if ( strcmp ( arg, "--convert-size" ) == 0 )
+            {
+                options->convert_size = ( uint32_t ) number;
+            }
+            else
+            {
+                options->stream_megabytes = ( uint32_t ) number;
+            }
+        }
+        else
+        {
+            fprintf ( stderr, "Unknown option: %s\n", arg );
+            return 0;
+        }
+    }
+    if ( !options->compact && !options->blockwise )
+    {
+        fprintf ( stderr, "--compact-only and --blockwise-only can not be combined.\n" );
+        return 0;
+    }
+    return 1;
+}
+
+/* MEASUREMENT */
+
+/* Generate one maze with the given policy. Returns the number of bytes produced. */
+static uint64_t benchmark_generate_once ( const benchmark_result* scenario, uint64_t seed, uint8_t* buffer, uint64_t buffer_size )
+{
+    mazelib_prng prng;
+    uint64_t result;
+
+    benchmark_trace_push ( scenario->policy->name, scenario->width, scenario->height, scenario->policy->threshold, scenario->blockwise, 1 );
+    if ( scenario->policy->callback == NULL )
+    {
+        result = mazelib_generate ( scenario->width, scenario->height, seed, scenario->policy->threshold, scenario->blockwise, buffer, buffer_size );
+    }
+    else
+    {
+        mazelib_prng_seed ( &prng, seed );
+        result = mazelib_generate_extended ( scenario->width, scenario->height, &prng, scenario->policy->callback, NULL, scenario->blockwise, buffer, buffer_size );
+    }
+    benchmark_trace_end ();
+    return result;
+}
+
+/*
+* Run one scenario: a warm up run which also faults in the buffer, followed by timed repetitions.
+* Every repetition uses the same seed, so every repetition does exactly the same work.
+* If counters is not NULL, they are enabled around the timed repetitions only.
+*/
+static int benchmark_run_scenario ( benchmark_result* scenario, const benchmark_options* options, const benchmark_counters* counters, uint8_t* buffer, uint64_t buffer_size )
+{
+    double counter_totals[BENCHMARK_COUNTER_COUNT];
+    unsigned int i;
+    const uint64_t min_ns = ( uint64_t ) ( options->min_seconds * 1e9 );
+    uint64_t total_ns = 0;
+    double sum = 0.0, sum_squares = 0.0;
+    unsigned int n = 0;
+
+    scenario->output_bytes = benchmark_generate_once ( scenario, options->seed, buffer, buffer_size );
+    if ( scenario->output_bytes == 0 )
+    {
+        return 0;
+    }
+    scenario->scratch_bytes = buffer_size - scenario->output_bytes;
+    scenario->min_ns = 0.0;
+    scenario->max_ns = 0.0;
+
+    if ( counters )
+    {
+        benchmark_start_counters ( counters );
+    }
+    while ( n < options->min_repetitions || total_ns < min_ns )
+    {
+        const uint64_t start = benchmark_now_ns ();
+        uint64_t elapsed;
+        double x;
+
+        benchmark_generate_once ( scenario, options->seed, buffer, buffer_size );
+        elapsed = benchmark_now_ns () - start;
+        x = ( double ) elapsed;
+        total_ns += elapsed;
+        sum += x;
+        sum_squares += x * x;
+        if ( n == 0 || x < scenario->min_ns )
+        {
+            scenario->min_ns = x;
+        }
+        if ( x > scenario->max_ns )
+        {
+            scenario->max_ns = x;
+        }
+        ++n;
+    }
+    if ( counters )
+    {
+        const double cells = ( double ) scenario->width * ( double ) scenario->height * n;
+        benchmark_stop_counters ( counters, counter_totals );
+        for ( i = 0; i < BENCHMARK_COUNTER_COUNT; ++i )
+        {
+            scenario->counters_per_cell[i] = counter_totals[i] < 0.0 ? -1.0 : counter_totals[i] / cells;
+        }
+    }
+    scenario->repetitions = n;
+    scenario->mean_ns = sum / n;
+    scenario->stddev_ns = n > 1 ? sqrt ( ( sum_squares - sum * sum / n ) / ( n - 1 ) ) : 0.0;
+    return 1;
+}
+
+/* VERIFICATION */
+
+typedef struct benchmark_golden benchmark_golden;
+struct benchmark_golden
+{
+    uint32_t width;
+    uint32_t height;
+    int8_t threshold;
+    uint64_t seed;
+    uint64_t compact_hash;
+    uint64_t blockwise_hash;
+};
+
+/*
+* Sizes cover single rows and columns, both sides of the switch from 1 to 2 and from 2 to 4 bytes per listed cell, and mazes which are much taller than they are wide.
+* Thresholds include -1 (drawn from the seed) and 127 (clamped to 100).
+*/
+static const uint32_t benchmark_golden_dimensions[][2] =
+{
+    { 1, 1 }, { 1, 7 }, { 7, 1 }, { 2, 2 }, { 3, 5 }, { 16, 15 }, { 15, 17 }, { 31, 9 }, { 64, 64 }, { 100, 37 }, { 256, 255 }, { 257, 255 }, { 300, 300 }, { 9, 1000 }
+};
+static const int8_t benchmark_golden_thresholds[] = { -1, 0, 25, 50, 100, 127 };
+static const uint64_t benchmark_golden_seeds[] = { 0, 42, 0xffffffffffffffff };
+
+#define BENCHMARK_GOLDEN_DIMENSION_COUNT ( sizeof ( benchmark_golden_dimensions ) / sizeof ( benchmark_golden_dimensions[0] ) )
+#define BENCHMARK_GOLDEN_THRESHOLD_COUNT ( sizeof ( benchmark_golden_thresholds ) / sizeof ( benchmark_golden_thresholds[0] ) )
+#define BENCHMARK_GOLDEN_SEED_COUNT ( sizeof ( benchmark_golden_seeds ) / sizeof ( benchmark_golden_seeds[0] ) )
+
+/* Generated with --print-corpus from version 1.0 of the library, in the order of the arrays above. */
+static const benchmark_golden benchmark_golden_corpus[] =
+{
+    { 1, 1, -1, 0x0000000000000000, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, -1, 0x000000000000002a, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, -1, 0xffffffffffffffff, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 0, 0x0000000000000000, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 0, 0x000000000000002a, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 0, 0xffffffffffffffff, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 25, 0x0000000000000000, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 25, 0x000000000000002a, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 25, 0xffffffffffffffff, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 50, 0x0000000000000000, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 50, 0x000000000000002a, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 50, 0xffffffffffffffff, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 100, 0x0000000000000000, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 100, 0x000000000000002a, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 100, 0xffffffffffffffff, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 127, 0x0000000000000000, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 127, 0x000000000000002a, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 1, 127, 0xffffffffffffffff, 0xaf63bd4c8601b7df, 0xf1844685e5b1d1cf },
+    { 1, 7, -1, 0x0000000000000000, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, -1, 0x000000000000002a, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, -1, 0xffffffffffffffff, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 0, 0x0000000000000000, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 0, 0x000000000000002a, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 0, 0xffffffffffffffff, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 25, 0x0000000000000000, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 25, 0x000000000000002a, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 25, 0xffffffffffffffff, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 50, 0x0000000000000000, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 50, 0x000000000000002a, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 50, 0xffffffffffffffff, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 100, 0x0000000000000000, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 100, 0x000000000000002a, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 100, 0xffffffffffffffff, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 127, 0x0000000000000000, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 127, 0x000000000000002a, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 1, 7, 127, 0xffffffffffffffff, 0x94953d5270688cbf, 0x59d390c79e2488ef },
+    { 7, 1, -1, 0x0000000000000000, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, -1, 0x000000000000002a, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, -1, 0xffffffffffffffff, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 0, 0x0000000000000000, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 0, 0x000000000000002a, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 0, 0xffffffffffffffff, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 25, 0x0000000000000000, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 25, 0x000000000000002a, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 25, 0xffffffffffffffff, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 50, 0x0000000000000000, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 50, 0x000000000000002a, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 50, 0xffffffffffffffff, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 100, 0x0000000000000000, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 100, 0x000000000000002a, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 100, 0xffffffffffffffff, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 127, 0x0000000000000000, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 127, 0x000000000000002a, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 7, 1, 127, 0xffffffffffffffff, 0x0c276618d6eb175d, 0x7fd60d9a72edc9af },
+    { 2, 2, -1, 0x0000000000000000, 0x191d27c232231edc, 0x841f4717ae478809 },
+    { 2, 2, -1, 0x000000000000002a, 0x7b99d3d2f21492d3, 0xb4d15be534c46f81 },
+    { 2, 2, -1, 0xffffffffffffffff, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 2, 2, 0, 0x0000000000000000, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 2, 2, 0, 0x000000000000002a, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 2, 2, 0, 0xffffffffffffffff, 0x9e858b90541dbb73, 0x0fc38cfc5a4e4205 },
+    { 2, 2, 25, 0x0000000000000000, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 2, 2, 25, 0x000000000000002a, 0x191d27c232231edc, 0x841f4717ae478809 },
+    { 2, 2, 25, 0xffffffffffffffff, 0x7b99d3d2f21492d3, 0xb4d15be534c46f81 },
+    { 2, 2, 50, 0x0000000000000000, 0x191d27c232231edc, 0x841f4717ae478809 },
+    { 2, 2, 50, 0x000000000000002a, 0x191d27c232231edc, 0x841f4717ae478809 },
+    { 2, 2, 50, 0xffffffffffffffff, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 2, 2, 100, 0x0000000000000000, 0x9e858b90541dbb73, 0x0fc38cfc5a4e4205 },
+    { 2, 2, 100, 0x000000000000002a, 0x191d27c232231edc, 0x841f4717ae478809 },
+    { 2, 2, 100, 0xffffffffffffffff, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 2, 2, 127, 0x0000000000000000, 0x9e858b90541dbb73, 0x0fc38cfc5a4e4205 },
+    { 2, 2, 127, 0x000000000000002a, 0x191d27c232231edc, 0x841f4717ae478809 },
+    { 2, 2, 127, 0xffffffffffffffff, 0x6a2ba8d2e82d73b6, 0x5af1969348ef1e8d },
+    { 3, 5, -1, 0x0000000000000000, 0x244fa4e336cf3731, 0x510d532ce40c32ff },
+    { 3, 5, -1, 0x000000000000002a, 0x05b5c62c81c03257, 0x24c55b3c6c4f7e8b },
+    { 3, 5, -1, 0xffffffffffffffff, 0xbda854a39339041e, 0xbbe1e38b1943a38f },
+    { 3, 5, 0, 0x0000000000000000, 0x05a1d51378df522e, 0x223f2962be4f70a7 },
+    { 3, 5, 0, 0x000000000000002a, 0x216232577e2adf5e, 0x5c4700d8ffffa717 },
+    { 3, 5, 0, 0xffffffffffffffff, 0x0228b3787662a8fa, 0x2aa4329b56573403 },
+    { 3, 5, 25, 0x0000000000000000, 0x738a8f146265ef50, 0xbf5bf315d94a28db },
+    { 3, 5, 25, 0x000000000000002a, 0x7a625cf8f8135004, 0xf6ecfe5eb66a371b },
+    { 3, 5, 25, 0xffffffffffffffff, 0x5be6a59465036425, 0x57ae5ebb95552207 },
+    { 3, 5, 50, 0x0000000000000000, 0xee7a576a9482fd2f, 0xfcbb568361aa742f },
+    { 3, 5, 50, 0x000000000000002a, 0xc4a257d3a4cd21a5, 0x79202ae93075c527 },
+    { 3, 5, 50, 0xffffffffffffffff, 0x6ff35c78f3696e12, 0x96251f88581e4daf },
+    { 3, 5, 100, 0x0000000000000000, 0xd0bba9a4baddada3, 0xcb0b0ee4c8474e07 },
+    { 3, 5, 100, 0x000000000000002a, 0x546d725bba3bff5b, 0x9b9287a090478bb3 },
+    { 3, 5, 100, 0xffffffffffffffff, 0x17e3976a21eb6977, 0xebb2e17dddcc9d57 },
+    { 3, 5, 127, 0x0000000000000000, 0xd0bba9a4baddada3, 0xcb0b0ee4c8474e07 },
+    { 3, 5, 127, 0x000000000000002a, 0x546d725bba3bff5b, 0x9b9287a090478bb3 },
+    { 3, 5, 127, 0xffffffffffffffff, 0x17e3976a21eb6977, 0xebb2e17dddcc9d57 },
+    { 16, 15, -1, 0x0000000000000000, 0xf74459409ebfb925, 0xc1c99198cf20c61b },
+    { 16, 15, -1, 0x000000000000002a, 0xb513113bed2240d7, 0xc5b0ccb72d40a6fb },
+    { 16, 15, -1, 0xffffffffffffffff, 0x1646213788013c8d, 0x85d194fd2658af6f },
+    { 16, 15, 0, 0x0000000000000000, 0xfb4b1321c1549751, 0x4edcf2746dd2758b },
+    { 16, 15, 0, 0x000000000000002a, 0x55cc11cd6127f0f1, 0x222ada4862ef0c03 },
+    { 16, 15, 0, 0xffffffffffffffff, 0xdae5e3f44325e5f6, 0x1fa50e05932d20c7 },
+    { 16, 15, 25, 0x0000000000000000, 0x97c72755e4c2790b, 0x1f7fd98ecc7b7217 },
+    { 16, 15, 25, 0x000000000000002a, 0x2faee40628de4453, 0x5ddb5ca297ca20cb },
+    { 16, 15, 25, 0xffffffffffffffff, 0xb8622a829a862c26, 0xf57520d0c0fb452b },
+    { 16, 15, 50, 0x0000000000000000, 0x64e97095fd0289f6, 0x9c8b14067964d6ab },
+    { 16, 15, 50, 0x000000000000002a, 0x158e6d4205ac3c5e, 0x978b8de4c741bf3b },
+    { 16, 15, 50, 0xffffffffffffffff, 0x09662aca3a09d34f, 0x46c4c68f8d28b60f },
+    { 16, 15, 100, 0x0000000000000000, 0x60c751755c347b6a, 0x470c14162a97281b },
+    { 16, 15, 100, 0x000000000000002a, 0x88ef3a3e9e0ba034, 0x80d8393b2bfcc16b },
+    { 16, 15, 100, 0xffffffffffffffff, 0x11dbb261a0163ec2, 0xaf02ab148ad4f853 },
+    { 16, 15, 127, 0x0000000000000000, 0x60c751755c347b6a, 0x470c14162a97281b },
+    { 16, 15, 127, 0x000000000000002a, 0x88ef3a3e9e0ba034, 0x80d8393b2bfcc16b },
+    { 16, 15, 127, 0xffffffffffffffff, 0x11dbb261a0163ec2, 0xaf02ab148ad4f853 },
+    { 15, 17, -1, 0x0000000000000000, 0xc7e99b1c3cbabea1, 0xe61958194af1e953 },
+    { 15, 17, -1, 0x000000000000002a, 0xb9399d1967585fc9, 0xe86a285559f8538b },
+    { 15, 17, -1, 0xffffffffffffffff, 0x9472f10dc34a8e72, 0xf59dc2e263e8de2b },
+    { 15, 17, 0, 0x0000000000000000, 0xa081c660fbda7dd3, 0xd398a54de40b7ec7 },
+    { 15, 17, 0, 0x000000000000002a, 0x9a2592e7b6195dd3, 0x61e6a80bf62418ab },
+    { 15, 17, 0, 0xffffffffffffffff, 0xe99e8d06ef7cc578, 0xb83683742a45c747 },
+    { 15, 17, 25, 0x0000000000000000, 0x6e36543c20fce8ad, 0xaa8a2275c08d34ff },
+    { 15, 17, 25, 0x000000000000002a, 0xbf5ffa100c0d9389, 0x5d9c3303b7fd371f },
+    { 15, 17, 25, 0xffffffffffffffff, 0xbed1c6de8ecf1de0, 0x2375bfe26a91576f },
+    { 15, 17, 50, 0x0000000000000000, 0xd9165c2e8f851b7d, 0xd1c6d5b13a3afb4b },
+    { 15, 17, 50, 0x000000000000002a, 0x4670296c45c13170, 0x08967425c123b1c7 },
+    { 15, 17, 50, 0xffffffffffffffff, 0x07dc1681b610e6ad, 0xef8f63b077599fcb },
+    { 15, 17, 100, 0x0000000000000000, 0x70bc42cbd268789a, 0xec6b65ad4731aa03 },
+    { 15, 17, 100, 0x000000000000002a, 0x27f764871bb51779, 0xdf961cd728de87ef },
+    { 15, 17, 100, 0xffffffffffffffff, 0xe79a0c34c800defe, 0xa83ca68b5a215fdb },
+    { 15, 17, 127, 0x0000000000000000, 0x70bc42cbd268789a, 0xec6b65ad4731aa03 },
+    { 15, 17, 127, 0x000000000000002a, 0x27f764871bb51779, 0xdf961cd728de87ef },
+    { 15, 17, 127, 0xffffffffffffffff, 0xe79a0c34c800defe, 0xa83ca68b5a215fdb },
+    { 31, 9, -1, 0x0000000000000000, 0x7137733bf8e1aadc, 0x2a13f3a6df8ee313 },
+    { 31, 9, -1, 0x000000000000002a, 0x242f33b60db9512f, 0xb4c718d53aa4df3b },
+    { 31, 9, -1, 0xffffffffffffffff, 0x629441dc25a4dc45, 0x063ef5057eec9f4b },
+    { 31, 9, 0, 0x0000000000000000, 0x4efc1de9cc24d09c, 0x9e8d51326c991b4f },
+    { 31, 9, 0, 0x000000000000002a, 0xb3012bebdedfe136, 0x8407e206142e165f },
+    { 31, 9, 0, 0xffffffffffffffff, 0xaf0a32634d6bcc4b, 0xe32451973c3c720f },
+    { 31, 9, 25, 0x0000000000000000, 0x1c03cfd312848ced, 0xbdd154135af12a9b },
+    { 31, 9, 25, 0x000000000000002a, 0xe5c11aa45c50ee66, 0x1e6497c0dab2d4eb },
+    { 31, 9, 25, 0xffffffffffffffff, 0x4ded7635038f7591, 0x26f72aaacda140f3 },
+    { 31, 9, 50, 0x0000000000000000, 0xaea4da932bc70c38, 0x0cb9cd30ee4e3ee3 },
+    { 31, 9, 50, 0x000000000000002a, 0xacf0ec0e94bd6831, 0x9fcf0a8a92ad765f },
+    { 31, 9, 50, 0xffffffffffffffff, 0xa2d3ea90d158435c, 0x24d71436dcd968a3 },
+    { 31, 9, 100, 0x0000000000000000, 0x249e4ebeb802609f, 0x526af0aa814120d7 },
+    { 31, 9, 100, 0x000000000000002a, 0x2ed83c276b997d3f, 0x122f28b0471b39e7 },
+    { 31, 9, 100, 0xffffffffffffffff, 0xea8217c158179372, 0x58075c11d616ae23 },
+    { 31, 9, 127, 0x0000000000000000, 0x249e4ebeb802609f, 0x526af0aa814120d7 },
+    { 31, 9, 127, 0x000000000000002a, 0x2ed83c276b997d3f, 0x122f28b0471b39e7 },
+    { 31, 9, 127, 0xffffffffffffffff, 0xea8217c158179372, 0x58075c11d616ae23 },
+    { 64, 64, -1, 0x0000000000000000, 0x145aef9de31c14b8, 0x137f14028935b671 },
+    { 64, 64, -1, 0x000000000000002a, 0x9e9dc452bc7d549f, 0xb2a2005502901fe9 },
+    { 64, 64, -1, 0xffffffffffffffff, 0xb423e4c0b834f97a, 0x0e4d7b4ab57bbc39 },
+    { 64, 64, 0, 0x0000000000000000, 0xb5b6f789ceae3443, 0x2bbf4ffb1bfeb199 },
+    { 64, 64, 0, 0x000000000000002a, 0xbb5d51b5a3e1ca26, 0xa059b9f2b5aad225 },
+    { 64, 64, 0, 0xffffffffffffffff, 0x26a11d9e33fa4ce2, 0xcdca47c8c70b6aa9 },
+    { 64, 64, 25, 0x0000000000000000, 0x1eb48d09e01d38f5, 0x6353ff3c5f022051 },
+    { 64, 64, 25, 0x000000000000002a, 0xd2d42f3e1ea03742, 0xe87158a24b0105dd },
+    { 64, 64, 25, 0xffffffffffffffff, 0x0030cf6276ec7282, 0x282342ac500ebc2d },
+    { 64, 64, 50, 0x0000000000000000, 0xaa4f03c20fa54469, 0xe61e7ec037691b5d },
+    { 64, 64, 50, 0x000000000000002a, 0x5731e9c830cdd011, 0x89229a7a1c971e09 },
+    { 64, 64, 50, 0xffffffffffffffff, 0x4d830f63382a799f, 0x4a1b8660270619d1 },
+    { 64, 64, 100, 0x0000000000000000, 0x03bc714a8394838f, 0x11b21e24b9e41061 },
+    { 64, 64, 100, 0x000000000000002a, 0xf003776fb000bacf, 0xb4eeea6d6ebb7449 },
+    { 64, 64, 100, 0xffffffffffffffff, 0xc36a57a2ff47f460, 0x2e4f9a09f9af3235 },
+    { 64, 64, 127, 0x0000000000000000, 0x03bc714a8394838f, 0x11b21e24b9e41061 },
+    { 64, 64, 127, 0x000000000000002a, 0xf003776fb000bacf, 0xb4eeea6d6ebb7449 },
+    { 64, 64, 127, 0xffffffffffffffff, 0xc36a57a2ff47f460, 0x2e4f9a09f9af3235 },
+    { 100, 37, -1, 0x0000000000000000, 0x6ebf50ea36802980, 0xff5c4b973423d387 },
+    { 100, 37, -1, 0x000000000000002a, 0x31776ea10cb97458, 0xd35c610f64a1d233 },
+    { 100, 37, -1, 0xffffffffffffffff, 0x3d2e84c78992a139, 0xd4ca37ae633b8d63 },
+    { 100, 37, 0, 0x0000000000000000, 0xd143eee63fb11ddc, 0xfc5a1c70baae1ceb },
+    { 100, 37, 0, 0x000000000000002a, 0xfc305ca1084e6cb3, 0xfb41ba3143b8a28b },
+    { 100, 37, 0, 0xffffffffffffffff, 0xad1cb7980be5d619, 0x08f749a77b691dd7 },
+    { 100, 37, 25, 0x0000000000000000, 0x4dbe155118a2079c, 0xb979960d185a4693 },
+    { 100, 37, 25, 0x000000000000002a, 0xf398429ded44d2a5, 0xbec94dfe53ce4e2b },
+    { 100, 37, 25, 0xffffffffffffffff, 0x402be3081a65a356, 0x7e9455f976370d4b },
+    { 100, 37, 50, 0x0000000000000000, 0x9ed45735ee763415, 0xfbca9be1021cc58b },
+    { 100, 37, 50, 0x000000000000002a, 0x4ee00717c37c244c, 0x4c867d0d92637857 },
+    { 100, 37, 50, 0xffffffffffffffff, 0xe676620a19321904, 0xed6a7f60ecf98763 },
+    { 100, 37, 100, 0x0000000000000000, 0x8993ca0b662745c9, 0xa937eefbb4135e0f },
+    { 100, 37, 100, 0x000000000000002a, 0x2ce59ea7f9420d0e, 0x0140bfe8e80852e7 },
+    { 100, 37, 100, 0xffffffffffffffff, 0x22d23f25239d28bc, 0x9bfa3acaebf6511b },
+    { 100, 37, 127, 0x0000000000000000, 0x8993ca0b662745c9, 0xa937eefbb4135e0f },
+    { 100, 37, 127, 0x000000000000002a, 0x2ce59ea7f9420d0e, 0x0140bfe8e80852e7 },
+    { 100, 37, 127, 0xffffffffffffffff, 0x22d23f25239d28bc, 0x9bfa3acaebf6511b },
+    { 256, 255, -1, 0x0000000000000000, 0x56daf46291f8f6c6, 0xbcb6ce42bf96b863 },
+    { 256, 255, -1, 0x000000000000002a, 0x7c097fcb22beb9b8, 0xf73e614100023c83 },
+    { 256, 255, -1, 0xffffffffffffffff, 0x592381daefb393f9, 0xd200cbf35f4953f7 },
+    { 256, 255, 0, 0x0000000000000000, 0xbb52809313005e3e, 0x2999f2ac2d10ec9b },
+    { 256, 255, 0, 0x000000000000002a, 0xb40d5b7a5253f788, 0x7bd94f88603678cf },
+    { 256, 255, 0, 0xffffffffffffffff, 0x8f25447cfe030a12, 0xf7c1e609f28827b7 },
+    { 256, 255, 25, 0x0000000000000000, 0xc386c7d875f22628, 0x113db2c375ccbbdf },
+    { 256, 255, 25, 0x000000000000002a, 0x69c38b88a19a6b29, 0x75cbe626da82c9b7 },
+    { 256, 255, 25, 0xffffffffffffffff, 0x6acbcc1a0c122b91, 0x8b9941c695b6fb7b },
+    { 256, 255, 50, 0x0000000000000000, 0xd5534e92b52803ff, 0x4e67537f8115e70b },
+    { 256, 255, 50, 0x000000000000002a, 0x3062b9c290693a46, 0x6998ccaad545a407 },
+    { 256, 255, 50, 0xffffffffffffffff, 0xfc8a80c782d278c1, 0x3e8d0a6ae5a0a21b },
+    { 256, 255, 100, 0x0000000000000000, 0x57ba223aaaa40e16, 0xd470f559bc6fbdeb },
+    { 256, 255, 100, 0x000000000000002a, 0x6289fd7fb575f035, 0xfd54525c98aab76b },
+    { 256, 255, 100, 0xffffffffffffffff, 0x90b5fe57913dd1f1, 0xe20e1b04b4abc45f },
+    { 256, 255, 127, 0x0000000000000000, 0x57ba223aaaa40e16, 0xd470f559bc6fbdeb },
+    { 256, 255, 127, 0x000000000000002a, 0x6289fd7fb575f035, 0xfd54525c98aab76b },
+    { 256, 255, 127, 0xffffffffffffffff, 0x90b5fe57913dd1f1, 0xe20e1b04b4abc45f },
+    { 257, 255, -1, 0x0000000000000000, 0xbbcb936b10bf6066, 0x86b5dc7b1b500817 },
+    { 257, 255, -1, 0x000000000000002a, 0x70f748ef9aee9f8c, 0x30bafceb43ab4bfb },
+    { 257, 255, -1, 0xffffffffffffffff, 0x9f6b309aaa8d6a19, 0xa6e6997e4103726f },
+    { 257, 255, 0, 0x0000000000000000, 0x17642f5e9fa68410, 0x55516e0f7303e263 },
+    { 257, 255, 0, 0x000000000000002a, 0x23437b062734fc72, 0xcb3a4e8c7c555eef },
+    { 257, 255, 0, 0xffffffffffffffff, 0x585d283504511cd7, 0x13e53a657754e25f },
+    { 257, 255, 25, 0x0000000000000000, 0xa4fe17da152eb91e, 0xb845cfc914948a47 },
+    { 257, 255, 25, 0x000000000000002a, 0x2992053da62bbd84, 0x94575ea5f179ac53 },
+    { 257, 255, 25, 0xffffffffffffffff, 0xd4ba78a46c9c6e86, 0xc242a06ed0390823 },
+    { 257, 255, 50, 0x0000000000000000, 0xc77bd7b0bc5e689d, 0xb777e670fccfa7fb },
+    { 257, 255, 50, 0x000000000000002a, 0x17de5ad9f8f8bf97, 0x0c2f1b6338a7e137 },
+    { 257, 255, 50, 0xffffffffffffffff, 0xb01a4da43c7dd953, 0xe212b78bc0ac0bdb },
+    { 257, 255, 100, 0x0000000000000000, 0xfaf80ce90d67786f, 0x5e9402a8cf2e12af },
+    { 257, 255, 100, 0x000000000000002a, 0x1816ad6b00563147, 0x4ce0e2d483eea88f },
+    { 257, 255, 100, 0xffffffffffffffff, 0x942763d3bac1b458, 0xd51948238f519d23 },
+    { 257, 255, 127, 0x0000000000000000, 0xfaf80ce90d67786f, 0x5e9402a8cf2e12af },
+    { 257, 255, 127, 0x000000000000002a, 0x1816ad6b00563147, 0x4ce0e2d483eea88f },
+    { 257, 255, 127, 0xffffffffffffffff, 0x942763d3bac1b458, 0xd51948238f519d23 },
+    { 300, 300, -1, 0x0000000000000000, 0x1bb23c42dea35a9d, 0x02e55f259f081c91 },
+    { 300, 300, -1, 0x000000000000002a, 0x8b7cccc308ab1218, 0x9a5f9b1169656675 },
+    { 300, 300, -1, 0xffffffffffffffff, 0xb5619cdedf0aa3a0, 0x1b17901165a275dd },
+    { 300, 300, 0, 0x0000000000000000, 0x1c76a76bacb2cd33, 0x21581386e0ba5a8d },
+    { 300, 300, 0, 0x000000000000002a, 0x4525c3a4be138732, 0x0d6fbc803e164ab9 },
+    { 300, 300, 0, 0xffffffffffffffff, 0xfb767175d3f3a1f8, 0x9abb90140d9051a9 },
+    { 300, 300, 25, 0x0000000000000000, 0xefacce84c7967d1a, 0xce741811428fed35 },
+    { 300, 300, 25, 0x000000000000002a, 0x64950f76b55f2756, 0x2c78b47c784e6b71 },
+    { 300, 300, 25, 0xffffffffffffffff, 0xd119648bee97ae7f, 0xe516c4c3086bfe95 },
+    { 300, 300, 50, 0x0000000000000000, 0xc4dc6505ed3ab0e3, 0x73dfd17512df098d },
+    { 300, 300, 50, 0x000000000000002a, 0x5e48c8c34cf285b2, 0x792607c5da5da98d },
+    { 300, 300, 50, 0xffffffffffffffff, 0x9e260ade7eb87832, 0x2f61a27e4ba3c3ed },
+    { 300, 300, 100, 0x0000000000000000, 0x3fd3fa5ca1f04664, 0xeaaf4c19073d69c1 },
+    { 300, 300, 100, 0x000000000000002a, 0x2e2e4b43114e13e3, 0xbe6f4948624cec59 },
+    { 300, 300, 100, 0xffffffffffffffff, 0xfbd9206576df73d6, 0xc70378918be740f9 },
+    { 300, 300, 127, 0x0000000000000000, 0x3fd3fa5ca1f04664, 0xeaaf4c19073d69c1 },
+    { 300, 300, 127, 0x000000000000002a, 0x2e2e4b43114e13e3, 0xbe6f4948624cec59 },
+    { 300, 300, 127, 0xffffffffffffffff, 0xfbd9206576df73d6, 0xc70378918be740f9 },
+    { 9, 1000, -1, 0x0000000000000000, 0x7afdcabc5adff986, 0x04c8939cae275bf3 },
+    { 9, 1000, -1, 0x000000000000002a, 0x713183f129c42a7d, 0x5b64c029bf4f12c7 },
+    { 9, 1000, -1, 0xffffffffffffffff, 0xc2f962adec0145c8, 0x0c785553eb994b9f },
+    { 9, 1000, 0, 0x0000000000000000, 0xaa9c3128775fea98, 0xe68fe5d582929c17 },
+    { 9, 1000, 0, 0x000000000000002a, 0x438073242f792d36, 0x21de17fcf8d32717 },
+    { 9, 1000, 0, 0xffffffffffffffff, 0x25ef1edcbe7c3e3f, 0x03589d25a51feefb },
+    { 9, 1000, 25, 0x0000000000000000, 0x201fe34100eb5dde, 0x26d449208e643b67 },
+    { 9, 1000, 25, 0x000000000000002a, 0x333bc8fc0723aab1, 0x2748e42a2795a187 },
+    { 9, 1000, 25, 0xffffffffffffffff, 0x52bc3fab9fd8589a, 0xbd0492f0bf3a6f4b },
+    { 9, 1000, 50, 0x0000000000000000, 0x9fc3d9fe99f790e8, 0xdaa1aab6b6d90beb },
+    { 9, 1000, 50, 0x000000000000002a, 0xb50b979a01690a75, 0xf5379d52a138f503 },
+    { 9, 1000, 50, 0xffffffffffffffff, 0xe8c384d61dbd614e, 0x7c8a106413c43aaf },
+    { 9, 1000, 100, 0x0000000000000000, 0x647f6689b1bd15cd, 0xa489dd997582abd7 },
+    { 9, 1000, 100, 0x000000000000002a, 0x1540f901521809cc, 0xbbf7bd5876275687 },
+    { 9, 1000, 100, 0xffffffffffffffff, 0x8bb5a78ebfc7462e, 0x34867a337be344cf },
+    { 9, 1000, 127, 0x0000000000000000, 0x647f6689b1bd15cd, 0xa489dd997582abd7 },
+    { 9, 1000, 127, 0x000000000000002a, 0x1540f901521809cc, 0xbbf7bd5876275687 },
+    { 9, 1000, 127, 0xffffffffffffffff, 0x8bb5a78ebfc7462e, 0x34867a337be344cf },
+};
+
+#define BENCHMARK_GOLDEN_COUNT ( sizeof ( benchmark_golden_corpus ) / sizeof ( benchmark_golden_corpus[0] ) )
+
+static uint64_t benchmark_hash ( const uint8_t* data, uint64_t size )
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    uint64_t i;
+    for ( i = 0; i < size; ++i )
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/* The same selection as the high level API, so that mazelib_generate_extended can be checked against the same corpus. */
+static uint64_t benchmark_threshold_callback ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    const int8_t threshold = *( const int8_t* ) user;
+    if ( threshold > 0 && ( int8_t ) mazelib_prng_next_in_range ( prng, 101 ) < threshold )
+    {
+        return mazelib_prng_next_in_range ( prng, count );
+    }
+    return count - 1;
+}
+
+static uint64_t benchmark_generate_extended_like_high_level ( const benchmark_golden* golden, uint8_t blockwise, uint8_t* buffer, uint64_t buffer_size )
+{
+    mazelib_prng prng;
+    int8_t threshold = golden->threshold;
+
+    mazelib_prng_seed ( &prng, golden->seed );
+    if ( threshold < 0 )
+    {
+        threshold = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( threshold > 100 )
+    {
+        threshold = 100;
+    }
+    return mazelib_generate_extended ( golden->width, golden->height, &prng, benchmark_threshold_callback, &threshold, blockwise, buffer, buffer_size );
+}
+
+/* Convert a maze in three bands of different widths, the way a parallel caller would. Returns the size of the maze, or 0 on failure. */
+static uint64_t benchmark_convert_in_bands ( const benchmark_golden* golden, const uint8_t* compact, uint8_t* blockwise, uint64_t blockwise_size )
+{
+    const uint32_t first_end = golden->width / 3;
+    const uint32_t second_end = golden->width - golden->width / 4;
+
+    if ( mazelib_convert_columns_to_blockwise ( golden->width, golden->height, compact, second_end, golden->width - second_end, blockwise, blockwise_size ) == 0 )
+    {
+        return 0;
+    }
+    if ( mazelib_convert_columns_to_blockwise ( golden->width, golden->height, compact, first_end, second_end - first_end, blockwise, blockwise_size ) == 0 )
+    {
+        return 0;
+    }
+    return mazelib_convert_columns_to_blockwise ( golden->width, golden->height, compact, 0, first_end, blockwise, blockwise_size );
+}
+
+static int benchmark_check ( const benchmark_golden* golden, const char* path, uint64_t size, const uint8_t* output, uint64_t expected )
+{
+    const uint64_t hash = size ? benchmark_hash ( output, size ) : 0;
+    if ( hash == expected )
+    {
+        return 1;
+    }
+    printf ( "MISMATCH %ux%u seed %llu threshold %d: %s produced %016llx, expected %016llx\n", golden->width, golden->height, ( unsigned long long ) golden->seed, golden->threshold,
+             path, ( unsigned long long ) hash, ( unsigned long long ) expected );
+    return 0;
+}
+
+/*
+* Check that mazes with waypoints are perfect and that the path from the first waypoint to the last passes the others in order.
+* The waypoints are random and distinct, 10 and more of them on mid-size grids. Returns 1 if the maze is right.
+*/
+static int benchmark_check_waypoint_maze ( uint32_t width, uint32_t height, const uint32_t* waypoints, uint32_t waypoint_count, const uint8_t* maze, uint32_t* parents, uint32_t* queue )
+{
+    const uint32_t area = width * height;
+    const uint32_t first = waypoints[0] * height + waypoints[1];
+    uint32_t head = 0, tail = 0, passages = 0, cell, i;
+    uint32_t next_waypoint = waypoint_count - 1;
+
+    for ( i = 0; i < area; ++i )
+    {
+        parents[i] = 0xffffffff;
+    }
+    parents[first] = first;
+    queue[tail++] = first;
+    while ( head < tail )
+    {
+        const uint32_t current = queue[head++];
+        const uint32_t x = current / height;
+        const uint32_t y = current % height;
+        const uint32_t neighbors[4] = { current - height, current + height, current - 1, current + 1 };
+        const uint8_t inside[4] = { x > 0, x + 1 < width, y > 0, y + 1 < height };
+        uint8_t d;
+
+        for ( d = 0; d < 4; ++d )
+        {
+            if ( !( maze[current] & ( 1 << d ) ) )
+            {
+                continue;
+            }
+            if ( !inside[d] || !( maze[neighbors[d]] & ( 1 << ( d ^ 1 ) ) ) )
+            {
+                return 0;
+            }
+            ++passages;
+            if ( parents[neighbors[d]] == 0xffffffff )
+            {
+                parents[neighbors[d]] = current;
+                queue[tail++] = neighbors[d];
+            }
+        }
+    }
+    /* A perfect maze reaches every cell, and a tree has one passage less than cells, each seen from both sides. */
+    if ( tail != area || passages != ( area - 1 ) * 2 )
+    {
+        return 0;
+    }
+
+    /* Walk back from the last waypoint and meet the others in reverse order. */
+    for ( cell = waypoints[next_waypoint * 2] * height + waypoints[next_waypoint * 2 + 1];; cell = parents[cell] )
+    {
+        for ( i = 0; i < waypoint_count; ++i )
+        {
+            if ( waypoints[i * 2] * height + waypoints[i * 2 + 1] == cell )
+            {
+                if ( i != next_waypoint )
+                {
+                    return 0;
+                }
+                --next_waypoint;
+                break;
+            }
+        }
+        if ( cell == first )
+        {
+            return next_waypoint == 0xffffffff;
+        }
+    }
+}
+
+/* Generate mazes with waypoints over a few sizes and seeds. Returns the number of failed checks, or -1 if memory could not be allocated. */
+static int benchmark_verify_waypoints ( void )
+{
+    static const uint32_t sizes[][3] = { { 50, 50, 10 }, { 50, 50, 12 }, { 64, 48, 10 } };
+    const uint32_t seed_count = 16;
+    int checks = 0, failures = 0;
+    unsigned int s;
+
+    for ( s = 0; s < sizeof ( sizes ) / sizeof ( sizes[0] ); ++s )
+    {
+        const uint32_t width = sizes[s][0];
+        const uint32_t height = sizes[s][1];
+        const uint32_t waypoint_count = sizes[s][2];
+        const uint64_t size = mazelib_get_required_buffer_size ( width, height, 0 );
+        uint8_t* maze = ( uint8_t* ) malloc ( ( size_t ) size );
+        uint32_t* scratch = ( uint32_t* ) malloc ( ( size_t ) width * height * 4 * sizeof ( uint32_t ) );
+        uint32_t waypoints[32];
+        uint32_t seed;
+
+        if ( maze == NULL || scratch == NULL )
+        {
+            free ( maze );
+            free ( scratch );
+            return -1;
+        }
+        for ( seed = 0; seed < seed_count; ++seed )
+        {
+            mazelib_prng prng;
+            uint32_t i, j;
+
+            mazelib_prng_seed ( &prng, seed );
+            for ( i = 0; i < waypoint_count; ++i )
+            {
+                waypoints[i * 2] = ( uint32_t ) mazelib_prng_next_in_range ( &prng, width );
+                waypoints[i * 2 + 1] = ( uint32_t ) mazelib_prng_next_in_range ( &prng, height );
+                for ( j = 0; j < i; ++j )
+                {
+                    if ( waypoints[j * 2] == waypoints[i * 2] && waypoints[j * 2 + 1] == waypoints[i * 2 + 1] )
+                    {
+                        --i;
+                        break;
+                    }
+                }
+            }
+
+            ++checks;
+            if ( mazelib_generate_with_waypoints ( width, height, seed, 50, waypoints, waypoint_count, scratch, 0, maze, size ) == 0 ||
+                 !benchmark_check_waypoint_maze ( width, height, waypoints, waypoint_count, maze, scratch, scratch + width * height ) )
+            {
+                printf ( "MISMATCH %ux%u seed %u: mazelib_generate_with_waypoints failed with %u waypoints\n", width, height, seed, waypoint_count );
+                ++failures;
+            }
+        }
+        free ( maze );
+        free ( scratch );
+    }
+    printf ( "%d of %d waypoint checks passed.\n", checks - failures, checks );
+    return failures;
+}
+
+/* Run every generation path over the corpus. Returns the number of failed checks, or -1 if memory could not be allocated. */
+static int benchmark_verify ( void )
+{
+    unsigned int i;
+    int checks = 0, failures = 0, waypoint_failures;
+
+    for ( i = 0; i < BENCHMARK_GOLDEN_COUNT; ++i )
+    {
+        const benchmark_golden* golden = &benchmark_golden_corpus[i];
+        const uint64_t compact_size = mazelib_get_required_buffer_size ( golden->width, golden->height, 0 );
+        const uint64_t blockwise_size = mazelib_get_required_buffer_size ( golden->width, golden->height, 1 );
+        uint8_t* compact = ( uint8_t* ) malloc ( ( size_t ) compact_size );
+        uint8_t* blockwise = ( uint8_t* ) malloc ( ( size_t ) blockwise_size );
+        uint64_t size;
+
+        if ( compact == NULL || blockwise == NULL )
+        {
+            free ( compact );
+            free ( blockwise );
+            return -1;
+        }
+
+        size = benchmark_generate_extended_like_high_level ( golden, 0, compact, compact_size );
+        failures += !benchmark_check ( golden, "mazelib_generate_extended (compact)", size, compact, golden->compact_hash );
+        size = benchmark_generate_extended_like_high_level ( golden, 1, blockwise, blockwise_size );
+        failures += !benchmark_check ( golden, "mazelib_generate_extended (blockwise)", size, blockwise, golden->blockwise_hash );
+
+        size = mazelib_generate ( golden->width, golden->height, golden->seed, golden->threshold, 0, compact, compact_size );
+        failures += !benchmark_check ( golden, "mazelib_generate (compact)", size, compact, golden->compact_hash );
+        size = mazelib_convert_to_blockwise ( golden->width, golden->height, compact, blockwise, blockwise_size );
+        failures += !benchmark_check ( golden, "mazelib_convert_to_blockwise", size, blockwise, golden->blockwise_hash );
+        memset ( blockwise, 0xff, ( size_t ) blockwise_size );
+        size = benchmark_convert_in_bands ( golden, compact, blockwise, blockwise_size );
+        failures += !benchmark_check ( golden, "mazelib_convert_columns_to_blockwise", size, blockwise, golden->blockwise_hash );
+        size = mazelib_generate ( golden->width, golden->height, golden->seed, golden->threshold, 1, blockwise, blockwise_size );
+        failures += !benchmark_check ( golden, "mazelib_generate (blockwise)", size, blockwise, golden->blockwise_hash );
+        checks += 6;
+
+        free ( compact );
+        free ( blockwise );
+    }
+    printf ( "%d of %d checks passed over %u corpus entries.\n", checks - failures, checks, ( unsigned int ) BENCHMARK_GOLDEN_COUNT );
+
+    waypoint_failures = benchmark_verify_waypoints ();
+    if ( waypoint_failures < 0 )
+    {
+        return -1;
+    }
+    return failures + waypoint_failures;
+}
+
+static int benchmark_print_corpus ( void )
+{
+    unsigned int d, t, s;
+
+    for ( d = 0; d < BENCHMARK_GOLDEN_DIMENSION_COUNT; ++d )
+    {
+        for ( t = 0; t < BENCHMARK_GOLDEN_THRESHOLD_COUNT; ++t )
+        {
+            for ( s = 0; s < BENCHMARK_GOLDEN_SEED_COUNT; ++s )
+            {
+                benchmark_golden golden;
+                uint64_t hashes[2];
+                uint8_t blockwise;
+
+                golden.width = benchmark_golden_dimensions[d][0];
+                golden.height = benchmark_golden_dimensions[d][1];
+                golden.threshold = benchmark_golden_thresholds[t];
+                golden.seed = benchmark_golden_seeds[s];
+                for ( blockwise = 0; blockwise < 2; ++blockwise )
+                {
+                    const uint64_t buffer_size = mazelib_get_required_buffer_size ( golden.width, golden.height, blockwise );
+                    uint8_t* buffer = ( uint8_t* ) malloc ( ( size_t ) buffer_size );
+                    uint64_t size;
+
+                    if ( buffer == NULL )
+                    {
+                        return 0;
+                    }
+                    size = mazelib_generate ( golden.width, golden.height, golden.seed, golden.threshold, blockwise, buffer, buffer_size );
+                    hashes[blockwise] = benchmark_hash ( buffer, size );
+                    free ( buffer );
+                }
+                printf ( "    { %u, %u, %d, 0x%016llx, 0x%016llx, 0x%016llx },\n", golden.width, golden.height, golden.threshold,
+                         ( unsigned long long ) golden.seed, ( unsigned long long ) hashes[0], ( unsigned long long ) hashes[1] );
+            }
+        }
+    }
+    return 1;
+}
+
+/* OUTPUT */
+
+static void benchmark_print_result ( FILE* out, const benchmark_result* result, benchmark_format format, int perf, int first )
+{
+    unsigned int i;
+    const double cells = ( double ) result->width * ( double ) result->height;
+    const double ns_per_cell = result->mean_ns / cells;
+    const double cells_per_second = cells * 1e9 / result->mean_ns;
+    const double relative_stddev = result->mean_ns > 0.0 ? 100.0 * result->stddev_ns / result->mean_ns : 0.0;
+    const char* format_name = result->blockwise ? "blockwise" : "compact";
+
+    switch ( format )
+    {
+        case benchmark_format_text:
+            if ( first )
+            {
+                fprintf ( out, "%-11s %-9s %-16s %9s %5s %12s %12s %14s %8s %14s", "size", "format", "policy", "threshold", "reps", "mean_ms", "ns/cell", "cells/s", "stddev%", "scratch_bytes" );
+                for ( i = 0; perf && i < BENCHMARK_COUNTER_COUNT; ++i )
+                {
+                    fprintf ( out, " %13s", benchmark_counter_names[i] );
+                }
+                fprintf ( out, "\n" );
+            }
+            fprintf ( out, "%5ux%-5u %-9s %-16s %9d %5u %12.3f %12.2f %14.0f %8.2f %14llu", result->width, result->height, format_name, result->policy->name, result->policy->threshold,
+                      result->repetitions, result->mean_ns / 1e6, ns_per_cell, cells_per_second, relative_stddev, ( unsigned long long ) result->scratch_bytes );
+            for ( i = 0; perf && i < BENCHMARK_COUNTER_COUNT; ++i )
+            {
+                if ( result->counters_per_cell[i] < 0.0 )
+                {
+                    fprintf ( out, " %13s", "n/a" );
+                }
+                else
+                {
+                    fprintf ( out, " %13.3f", result->counters_per_cell[i] );
+                }
+            }
+            fprintf ( out, "\n" );
+            break;
+        case benchmark_format_csv:
+            if ( first )
+            {
+                fprintf ( out, "width,height,format,policy,threshold,repetitions,mean_ns,min_ns,max_ns,stddev_ns,variance_ns2,ns_per_cell,cells_per_second,output_bytes,peak_scratch_bytes" );
+                for ( i = 0; perf && i < BENCHMARK_COUNTER_COUNT; ++i )
+                {
+                    fprintf ( out, ",%s_per_cell", benchmark_counter_names[i] );
+                }
+                fprintf ( out, "\n" );
+            }
+            fprintf ( out, "%u,%u,%s,%s,%d,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f,%.1f,%llu,%llu", result->width, result->height, format_name, result->policy->name, result->policy->threshold,
+                      result->repetitions, result->mean_ns, result->min_ns, result->max_ns, result->stddev_ns, result->stddev_ns * result->stddev_ns, ns_per_cell, cells_per_second,
+                      ( unsigned long long ) result->output_bytes, ( unsigned long long ) result->scratch_bytes );
+            /* Unavailable counters are left empty. */
+            for ( i = 0; perf && i < BENCHMARK_COUNTER_COUNT; ++i )
+            {
+                if ( result->counters_per_cell[i] < 0.0 )
+                {
+                    fprintf ( out, "," );
+                }
+                else
+                {
+                    fprintf ( out, ",%.4f", result->counters_per_cell[i] );
+                }
+            }
+            fprintf ( out, "\n" );
+            break;
+        default:
+            fprintf ( out, "%s\n    {\"width\": %u, \"height\": %u, \"format\": \"%s\", \"policy\": \"%s\", \"threshold\": %d, \"repetitions\": %u, "
+                      "\"mean_ns\": %.1f, \"min_ns\": %.1f, \"max_ns\": %.1f, \"stddev_ns\": %.1f, \"variance_ns2\": %.1f, \"ns_per_cell\": %.4f, \"cells_per_second\": %.1f, "
+                      "\"output_bytes\": %llu, \"peak_scratch_bytes\": %llu",
+                      first ? "" : ",", result->width, result->height, format_name, result->policy->name, result->policy->threshold, result->repetitions,
+                      result->mean_ns, result->min_ns, result->max_ns, result->stddev_ns, result->stddev_ns * result->stddev_ns, ns_per_cell, cells_per_second,
+                      ( unsigned long long ) result->output_bytes, ( unsigned long long ) result->scratch_bytes );
+            /* Unavailable counters are written as null. */
+            for ( i = 0; perf && i < BENCHMARK_COUNTER_COUNT; ++i )
+            {
+                if ( result->counters_per_cell[i] < 0.0 )
+                {
+                    fprintf ( out, ", \"%s_per_cell\": null", benchmark_counter_names[i] );
+                }
+                else
+                {
+                    fprintf ( out, ", \"%s_per_cell\": %.4f", benchmark_counter_names[i], result->counters_per_cell[i] );
+                }
+            }
+            fprintf ( out, "}" );
+            break;
+    }
+    fflush ( out );
+}
+
+/* RANDOM NUMBERS */
+
+#define BENCHMARK_PRNG_CALLS 4194304
+#define BENCHMARK_PRNG_REPETITIONS 5
+#define BENCHMARK_PRNG_MAZE_SIZE 256
+
+/* Results of anything the optimizer can not see through are added up here, so that the measured loops are not removed. */
+static volatile uint64_t benchmark_sink;
+
+typedef enum benchmark_prng_operation
+{
+    benchmark_prng_next,
+    benchmark_prng_next_in_range,
+    benchmark_prng_shuffle,
+    benchmark_prng_selection
+} benchmark_prng_operation;
+
+static const char* const benchmark_prng_operation_names[] = { "next", "next_in_range", "shuffle4", "threshold_selection" };
+
+typedef struct benchmark_prng_result benchmark_prng_result;
+struct benchmark_prng_result
+{
+    const char* name;
+    uint64_t parameter; /* The range, or the threshold. */
+    double ns_per_call; /* -1 if not measured. */
+    double rejection_rate; /* Measured share of numbers thrown away by the range reduction, -1 if not applicable. */
+    double expected_rejection_rate;
+    double draws_per_cell; /* -1 if not measured. */
+};
+
+/* The same four element Fisher-Yates shuffle that mazelib_generate_extended performs for every step. */
+static void benchmark_shuffle_directions ( mazelib_prng* prng, uint8_t* directions )
+{
+    uint64_t i;
+    for ( i = 3; i; --i )
+    {
+        const uint8_t swap_index = ( uint8_t ) mazelib_prng_next_in_range ( prng, i + 1 );
+        const uint8_t temp = directions[i];
+        directions[i] = directions[swap_index];
+        directions[swap_index] = temp;
+    }
+}
+
+/* Time BENCHMARK_PRNG_CALLS calls of one operation and return the best ns per call over a few repetitions. */
+static double benchmark_time_prng ( benchmark_prng_operation operation, uint64_t parameter, uint64_t seed )
+{
+    double best = 0.0;
+    unsigned int repetition;
+
+    for ( repetition = 0; repetition < BENCHMARK_PRNG_REPETITIONS; ++repetition )
+    {
+        mazelib_prng prng;
+        uint8_t directions[4] = { mazelib_west, mazelib_east, mazelib_north, mazelib_south };
+        int8_t threshold = ( int8_t ) parameter;
+        uint64_t sum = 0;
+        uint64_t start, i;
+        double ns;
+
+        mazelib_prng_seed ( &prng, seed );
+        start = benchmark_now_ns ();
+        switch ( operation )
+        {
+            case benchmark_prng_next:
+                for ( i = 0; i < BENCHMARK_PRNG_CALLS; ++i )
+                {
+                    sum += mazelib_prng_next ( &prng );
+                }
+                break;
+            case benchmark_prng_next_in_range:
+                for ( i = 0; i < BENCHMARK_PRNG_CALLS; ++i )
+                {
+                    sum += mazelib_prng_next_in_range ( &prng, parameter );
+                }
+                break;
+            case benchmark_prng_shuffle:
+                for ( i = 0; i < BENCHMARK_PRNG_CALLS; ++i )
+                {
+                    benchmark_shuffle_directions ( &prng, directions );
+                    sum += directions[0];
+                }
+                break;
+            default:
+                for ( i = 0; i < BENCHMARK_PRNG_CALLS; ++i )
+                {
+                    sum += benchmark_threshold_callback ( 1000, &prng, &threshold );
+                }
+                break;
+        }
+        ns = ( double ) ( benchmark_now_ns () - start ) / BENCHMARK_PRNG_CALLS;
+        benchmark_sink += sum;
+        if ( repetition == 0 || ns < best )
+        {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+/* Replay the draws of mazelib_prng_next_in_range and count how many of them fail the bias check. */
+static double benchmark_measure_rejection_rate ( uint64_t range, uint64_t seed )
+{
+    mazelib_prng prng;
+    uint64_t rejected = 0;
+    uint64_t i;
+
+    mazelib_prng_seed ( &prng, seed );
+    for ( i = 0; i < BENCHMARK_PRNG_CALLS; ++i )
+    {
+        const uint64_t x = mazelib_prng_next ( &prng );
+        if ( x - x % range > -range )
+        {
+            ++rejected;
+        }
+    }
+    return ( double ) rejected / BENCHMARK_PRNG_CALLS;
+}
+
+/* Numbers are rejected when they fall in the last 2^64 mod range values, and -range % range is 2^64 mod range. */
+static double benchmark_expected_rejection_rate ( uint64_t range )
+{
+    return ( double ) ( -range % range ) / 18446744073709551616.0;
+}
+
+typedef struct benchmark_counting_selection benchmark_counting_selection;
+struct benchmark_counting_selection
+{
+    int8_t threshold;
+    uint64_t draws;
+};
+
+/* The high level selection, counting the numbers it draws. */
+static uint64_t benchmark_counting_callback ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    benchmark_counting_selection* selection = ( benchmark_counting_selection* ) user;
+    if ( selection->threshold > 0 )
+    {
+        ++selection->draws;
+        if ( ( int8_t ) mazelib_prng_next_in_range ( prng, 101 ) < selection->threshold )
+        {
+            ++selection->draws;
+            return mazelib_prng_next_in_range ( prng, count );
+        }
+    }
+    return count - 1;
+}
+
+/*
+* Generate a maze with the given threshold and return the number of random numbers drawn per cell.
+* Without MAZELIB_STATS, the count is derived: two numbers for the first cell, three for the shuffle in each of the 2*cells-1 steps
+* (every cell is added once and removed once), plus whatever the callback drew. This ignores rejected numbers, which are vanishingly rare for these ranges.
+*/
+static double benchmark_draws_per_cell ( int8_t threshold, uint64_t seed )
+{
+    const uint32_t size = BENCHMARK_PRNG_MAZE_SIZE;
+    const uint64_t cells = ( uint64_t ) size * size;
+    const uint64_t buffer_size = mazelib_get_required_buffer_size ( size, size, 0 );
+    uint8_t* buffer = ( uint8_t* ) malloc ( ( size_t ) buffer_size );
+    benchmark_counting_selection selection;
+    mazelib_prng prng;
+    uint64_t draws;
+
+    if ( buffer == NULL )
+    {
+        return -1.0;
+    }
+    selection.threshold = threshold;
+    selection.draws = 0;
+    mazelib_prng_seed ( &prng, seed );
+    if ( mazelib_generate_extended ( size, size, &prng, benchmark_counting_callback, &selection, 0, buffer, buffer_size ) == 0 )
+    {
+        free ( buffer );
+        return -1.0;
+    }
+    free ( buffer );
+#ifdef MAZELIB_STATS
+    draws = prng.stats.prng_draws;
+#else
+    draws = 2 + 3 * ( 2 * cells - 1 ) + selection.draws;
+#endif
+    return ( double ) draws / ( double ) cells;
+}
+
+static void benchmark_print_prng_result ( FILE* out, const benchmark_prng_result* result, benchmark_format format, int first )
+{
+    switch ( format )
+    {
+        case benchmark_format_text:
+            if ( first )
+            {
+                fprintf ( out, "%-20s %20s %12s %12s %12s %14s\n", "operation", "parameter", "ns/call", "rejected%", "expected%", "draws/cell" );
+            }
+            fprintf ( out, "%-20s %20llu ", result->name, ( unsigned long long ) result->parameter );
+            if ( result->ns_per_call < 0.0 )
+            {
+                fprintf ( out, "%12s ", "-" );
+            }
+            else
+            {
+                fprintf ( out, "%12.3f ", result->ns_per_call );
+            }
+            if ( result->rejection_rate < 0.0 )
+            {
+                fprintf ( out, "%12s %12s ", "-", "-" );
+            }
+            else
+            {
+                fprintf ( out, "%12.3e %12.3e ", 100.0 * result->rejection_rate, 100.0 * result->expected_rejection_rate );
+            }
+            if ( result->draws_per_cell < 0.0 )
+            {
+                fprintf ( out, "%14s\n", "-" );
+            }
+            else
+            {
+                fprintf ( out, "%14.4f\n", result->draws_per_cell );
+            }
+            break;
+        case benchmark_format_csv:
+            /* Values that do not apply are left empty. */
+            if ( first )
+            {
+                fprintf ( out, "operation,parameter,ns_per_call,rejection_rate,expected_rejection_rate,draws_per_cell\n" );
+            }
+            fprintf ( out, "%s,%llu,", result->name, ( unsigned long long ) result->parameter );
+            if ( result->ns_per_call >= 0.0 )
+            {
+                fprintf ( out, "%.4f", result->ns_per_call );
+            }
+            fprintf ( out, "," );
+            if ( result->rejection_rate >= 0.0 )
+            {
+                fprintf ( out, "%.6e,%.6e", result->rejection_rate, result->expected_rejection_rate );
+            }
+            else
+            {
+                fprintf ( out, "," );
+            }
+            fprintf ( out, "," );
+            if ( result->draws_per_cell >= 0.0 )
+            {
+                fprintf ( out, "%.4f", result->draws_per_cell );
+            }
+            fprintf ( out, "\n" );
+            break;
+        default:
+            /* Values that do not apply are written as null. */
+            fprintf ( out, "%s\n    {\"operation\": \"%s\", \"parameter\": %llu", first ? "" : ",", result->name, ( unsigned long long ) result->parameter );
+            if ( result->ns_per_call >= 0.0 )
+            {
+                fprintf ( out, ", \"ns_per_call\": %.4f", result->ns_per_call );
+            }
+            else
+            {
+                fprintf ( out, ", \"ns_per_call\": null" );
+            }
+            if ( result->rejection_rate >= 0.0 )
+            {
+                fprintf ( out, ", \"rejection_rate\": %.6e, \"expected_rejection_rate\": %.6e", result->rejection_rate, result->expected_rejection_rate );
+            }
+            else
+            {
+                fprintf ( out, ", \"rejection_rate\": null, \"expected_rejection_rate\": null" );
+            }
+            if ( result->draws_per_cell >= 0.0 )
+            {
+                fprintf ( out, ", \"draws_per_cell\": %.4f}", result->draws_per_cell );
+            }
+            else
+            {
+                fprintf ( out, ", \"draws_per_cell\": null}" );
+            }
+            break;
+    }
+    fflush ( out );
+}
+
+static int benchmark_prng ( const benchmark_options* options, FILE* out )
+{
+    /* 2^63+1 is the worst case for the range reduction, where almost half of all numbers are thrown away. */
+    static const uint64_t ranges[] = { 2, 4, 101, 1000, 65537, 4294967296, 0x8000000000000001 };
+    static const int8_t thresholds[] = { 0, 25, 50, 100 };
+    benchmark_prng_result result;
+    unsigned int i;
+    int first = 1;
+
+    if ( options->format == benchmark_format_json )
+    {
+        fprintf ( out, "{\n  \"seed\": %llu,\n  \"calls\": %u,\n  \"results\": [", ( unsigned long long ) options->seed, BENCHMARK_PRNG_CALLS );
+    }
+
+    result.name = benchmark_prng_operation_names[benchmark_prng_next];
+    result.parameter = 0;
+    result.ns_per_call = benchmark_time_prng ( benchmark_prng_next, 0, options->seed );
+    result.rejection_rate = -1.0;
+    result.expected_rejection_rate = -1.0;
+    result.draws_per_cell = -1.0;
+    benchmark_print_prng_result ( out, &result, options->format, first );
+    first = 0;
+
+    for ( i = 0; i < sizeof ( ranges ) / sizeof ( ranges[0] ); ++i )
+    {
+        result.name = benchmark_prng_operation_names[benchmark_prng_next_in_range];
+        result.parameter = ranges[i];
+        result.ns_per_call = benchmark_time_prng ( benchmark_prng_next_in_range, ranges[i], options->seed );
+        result.rejection_rate = benchmark_measure_rejection_rate ( ranges[i], options->seed );
+        result.expected_rejection_rate = benchmark_expected_rejection_rate ( ranges[i] );
+        benchmark_print_prng_result ( out, &result, options->format, first );
+    }
+
+    result.name = benchmark_prng_operation_names[benchmark_prng_shuffle];
+    result.parameter = 4;
+    result.ns_per_call = benchmark_time_prng ( benchmark_prng_shuffle, 4, options->seed );
+    result.rejection_rate = -1.0;
+    result.expected_rejection_rate = -1.0;
+    benchmark_print_prng_result ( out, &result, options->format, first );
+
+    /* The selection is timed with a list of 1000 cells, and the draws per cell are counted over a whole maze. */
+    for ( i = 0; i < sizeof ( thresholds ) / sizeof ( thresholds[0] ); ++i )
+    {
+        result.name = benchmark_prng_operation_names[benchmark_prng_selection];
+        result.parameter = ( uint64_t ) thresholds[i];
+        result.ns_per_call = benchmark_time_prng ( benchmark_prng_selection, ( uint64_t ) thresholds[i], options->seed );
+        result.draws_per_cell = benchmark_draws_per_cell ( thresholds[i], options->seed );
+        benchmark_print_prng_result ( out, &result, options->format, first );
+    }
+
+    if ( options->format == benchmark_format_json )
+    {
+        fprintf ( out, "\n  ]\n}\n" );
+    }
+    return 0;
+}
+
+/* SCALING */
+
+#define BENCHMARK_MAX_THREADS 256
+#define BENCHMARK_SCALING_REPETITIONS 3
+
+typedef enum benchmark_workload
+{
+    benchmark_workload_stream,
+    benchmark_workload_batch,
+    benchmark_workload_convert,
+    benchmark_workload_components
+} benchmark_workload;
+
+static const char* const benchmark_workload_names[] = { "stream_triad", "batch_generate", "convert_columns", "label_components" };
+
+/* The share of a workload that is handed to one thread. Only the members for the given workload are used. */
+typedef struct benchmark_worker benchmark_worker;
+struct benchmark_worker
+{
+    benchmark_workload workload;
+    int cpu;
+    int failed;
+
+    /* Batch generation: mazes first_job...first_job+job_count (exclusive), each seeded with its own number. */
+    const benchmark_policy* policy;
+    uint32_t size;
+    uint32_t first_job;
+    uint32_t job_count;
+    uint8_t* buffer;
+    uint64_t buffer_size;
+
+    /* Conversion and labelling: a band of columns of one shared maze. */
+    const uint8_t* grid;
+    uint32_t first_column;
+    uint32_t column_count;
+    uint8_t* output;
+    uint64_t output_size;
+    uint32_t* labels;
+
+    /* Triad: elements first...first+count (exclusive) of the shared arrays. */
+    double* a;
+    const double* b;
+    const double* c;
+    size_t first;
+    size_t count;
+};
+
+static void benchmark_worker_run ( benchmark_worker* worker )
+{
+    uint32_t i;
+    size_t j;
+
+    if ( worker->cpu >= 0 )
+    {
+        benchmark_pin_thread ( worker->cpu );
+    }
+    switch ( worker->workload )
+    {
+        case benchmark_workload_stream:
+            for ( j = worker->first; j < worker->first + worker->count; ++j )
+            {
+                worker->a[j] = worker->b[j] + 3.0 * worker->c[j];
+            }
+            break;
+        case benchmark_workload_batch:
+            for ( i = 0; i < worker->job_count; ++i )
+            {
+                benchmark_result job;
+                memset ( &job, 0, sizeof ( job ) );
+                job.width = worker->size;
+                job.height = worker->size;
+                job.policy = worker->policy;
+                if ( benchmark_generate_once ( &job, worker->first_job + i, worker->buffer, worker->buffer_size ) == 0 )
+                {
+                    worker->failed = 1;
+                }
+            }
+            break;
+        case benchmark_workload_convert:
+            if ( worker->column_count && mazelib_convert_columns_to_blockwise ( worker->size, worker->size, worker->grid, worker->first_column, worker->column_count, worker->output, worker->output_size ) == 0 )
+            {
+                worker->failed = 1;
+            }
+            break;
+        default:
+            if ( worker->column_count && mazelib_label_component_band ( worker->size, worker->size, worker->grid, worker->first_column, worker->column_count, worker->labels ) == 0 )
+            {
+                worker->failed = 1;
+            }
+            break;
+    }
+}
+
+#if defined(_WIN32)
+
+typedef HANDLE benchmark_thread;
+
+static DWORD WINAPI benchmark_thread_entry ( LPVOID data )
+{
+    benchmark_worker_run ( ( benchmark_worker* ) data );
+    return 0;
+}
+
+static int benchmark_thread_start ( benchmark_thread* thread, benchmark_worker* worker )
+{
+    *thread = CreateThread ( NULL, 0, benchmark_thread_entry, worker, 0, NULL );
+    return *thread != NULL;
+}
+
+static void benchmark_thread_join ( benchmark_thread thread )
+{
+    WaitForSingleObject ( thread, INFINITE );
+    CloseHandle ( thread );
+}
+
+static unsigned int benchmark_cpu_count ( void )
+{
+    SYSTEM_INFO info;
+    GetSystemInfo ( &info );
+    return ( unsigned int ) info.dwNumberOfProcessors;
+}
+
+#else
+
+typedef pthread_t benchmark_thread;
+
+static void* benchmark_thread_entry ( void* data )
+{
+    benchmark_worker_run ( ( benchmark_worker* ) data );
+    return NULL;
+}
+
+static int benchmark_thread_start ( benchmark_thread* thread, benchmark_worker* worker )
+{
+    return pthread_create ( thread, NULL, benchmark_thread_entry, worker ) == 0;
+}
+
+static void benchmark_thread_join ( benchmark_thread thread )
+{
+    pthread_join ( thread, NULL );
+}
+
+static unsigned int benchmark_cpu_count ( void )
+{
+    const long count = sysconf ( _SC_NPROCESSORS_ONLN );
+    return count > 0 ? ( unsigned int ) count : 1;
+}
+
+#endif
+
+/* Run the workers on one thread each and return the wall clock time from starting the first to joining the last, in nanoseconds, or 0 on failure. */
+static uint64_t benchmark_run_workers ( benchmark_worker* workers, unsigned int count )
+{
+    benchmark_thread threads[BENCHMARK_MAX_THREADS];
+    unsigned int started = 0;
+    uint64_t start, elapsed;
+    int failed = 0;
+    unsigned int i;
+
+    start = benchmark_now_ns ();
+    while ( started < count && benchmark_thread_start ( &threads[started], &workers[started] ) )
+    {
+        ++started;
+    }
+    for ( i = 0; i < started; ++i )
+    {
+        benchmark_thread_join ( threads[i] );
+    }
+    elapsed = benchmark_now_ns () - start;
+    for ( i = 0; i < count; ++i )
+    {
+        failed |= workers[i].failed;
+    }
+    return started == count && !failed ? elapsed : 0;
+}
+
+/* Split total items into count nearly equal shares and return the first item and the length of share index. */
+static void benchmark_share ( uint64_t total, unsigned int count, unsigned int index, uint64_t* first, uint64_t* length )
+{
+    *first = total * index / count;
+    *length = total * ( index + 1 ) / count - *first;
+}
+
+typedef struct benchmark_scaling_result benchmark_scaling_result;
+struct benchmark_scaling_result
+{
+    benchmark_workload workload;
+    unsigned int threads;
+    double seconds;
+    double speedup;
+    double efficiency;
+    double items_per_second; /* Cells for the maze workloads, array elements for the triad. */
+    double bytes_per_second;
+    double stream_fraction;
+};
+
+static void benchmark_print_scaling_result ( FILE* out, const benchmark_scaling_result* result, benchmark_format format, int first )
+{
+    const char* name = benchmark_workload_names[result->workload];
+
+    switch ( format )
+    {
+        case benchmark_format_text:
+            if ( first )
+            {
+                fprintf ( out, "%-16s %7s %10s %8s %10s %14s %10s %8s\n", "workload", "threads", "seconds", "speedup", "efficiency", "items/s", "GB/s", "stream%" );
+            }
+            fprintf ( out, "%-16s %7u %10.4f %8.2f %10.2f %14.0f %10.2f %8.1f\n", name, result->threads, result->seconds, result->speedup, result->efficiency,
+                      result->items_per_second, result->bytes_per_second / 1e9, 100.0 * result->stream_fraction );
+            break;
+        case benchmark_format_csv:
+            if ( first )
+            {
+                fprintf ( out, "workload,threads,seconds,speedup,efficiency,items_per_second,bytes_per_second,stream_fraction\n" );
+            }
+            fprintf ( out, "%s,%u,%.6f,%.4f,%.4f,%.1f,%.1f,%.4f\n", name, result->threads, result->seconds, result->speedup, result->efficiency,
+                      result->items_per_second, result->bytes_per_second, result->stream_fraction );
+            break;
+        default:
+            fprintf ( out, "%s\n    {\"workload\": \"%s\", \"threads\": %u, \"seconds\": %.6f, \"speedup\": %.4f, \"efficiency\": %.4f, "
+                      "\"items_per_second\": %.1f, \"bytes_per_second\": %.1f, \"stream_fraction\": %.4f}",
+                      first ? "" : ",", name, result->threads, result->seconds, result->speedup, result->efficiency,
+                      result->items_per_second, result->bytes_per_second, result->stream_fraction );
+            break;
+    }
+    fflush ( out );
+}
+
+/*
+* Measure the four workloads with 1, 2, 4... threads up to the maximum (which is always included).
+* Each measurement is the best of a few runs, and buffers are allocated and faulted in before timing starts.
+*/
+static int benchmark_scaling ( const benchmark_options* options, FILE* out )
+{
+    const unsigned int cpus = benchmark_cpu_count ();
+    const unsigned int max_threads = options->max_threads ? ( options->max_threads < BENCHMARK_MAX_THREADS ? options->max_threads : BENCHMARK_MAX_THREADS ) : ( cpus < BENCHMARK_MAX_THREADS ? cpus : BENCHMARK_MAX_THREADS );
+    const size_t stream_count = ( size_t ) options->stream_megabytes * 1024 * 1024 / sizeof ( double );
+    const uint64_t batch_buffer_size = mazelib_get_required_buffer_size ( options->batch_size, options->batch_size, 0 );
+    const uint64_t convert_cells = ( uint64_t ) options->convert_size * options->convert_size;
+    const uint64_t convert_grid_size = mazelib_get_required_buffer_size ( options->convert_size, options->convert_size, 0 );
+    const uint64_t convert_output_size = ( ( uint64_t ) options->convert_size * 2 + 1 ) * ( ( uint64_t ) options->convert_size * 2 + 1 );
+    const benchmark_policy* policy = NULL;
+    benchmark_worker workers[BENCHMARK_MAX_THREADS];
+    double baseline[4] = { 0.0, 0.0, 0.0, 0.0 };
+    double* arrays = NULL;
+    uint8_t* batch_buffers = NULL;
+    uint8_t* grid = NULL;
+    uint8_t* output = NULL;
+    uint32_t* labels = NULL;
+    unsigned int threads, i;
+    int first = 1;
+    int status = 1;
+    size_t j;
+
+    for ( i = 0; i < BENCHMARK_POLICY_COUNT && policy == NULL; ++i )
+    {
+        if ( options->policy_mask & ( 1 << i ) )
+        {
+            policy = &benchmark_policies[i];
+        }
+    }
+
+    arrays = ( double* ) malloc ( stream_count * 3 * sizeof ( double ) );
+    batch_buffers = ( uint8_t* ) malloc ( ( size_t ) ( batch_buffer_size * max_threads ) );
+    grid = ( uint8_t* ) malloc ( ( size_t ) convert_grid_size );
+    output = ( uint8_t* ) malloc ( ( size_t ) convert_output_size );
+    labels = ( uint32_t* ) malloc ( ( size_t ) ( convert_cells * sizeof ( uint32_t ) ) );
+    if ( arrays == NULL || batch_buffers == NULL || grid == NULL || output == NULL || labels == NULL )
+    {
+        fprintf ( stderr, "Failed to allocate memory for the scaling benchmark.\n" );
+        goto done;
+    }
+    for ( j = 0; j < stream_count * 3; ++j )
+    {
+        arrays[j] = 1.0;
+    }
+    memset ( batch_buffers, 0, ( size_t ) ( batch_buffer_size * max_threads ) );
+    memset ( output, 0, ( size_t ) convert_output_size );
+    memset ( labels, 0, ( size_t ) ( convert_cells * sizeof ( uint32_t ) ) );
+
+    /* The maze to convert is generated once up front, with the fastest policy since only its conversion is measured. */
+    if ( mazelib_generate ( options->convert_size, options->convert_size, options->seed, 0, 0, grid, convert_grid_size ) == 0 )
+    {
+        fprintf ( stderr, "Failed to generate the maze for the conversion workload.\n" );
+        goto done;
+    }
+
+    if ( options->format == benchmark_format_json )
+    {
+        fprintf ( out, "{\n  \"cpus\": %u,\n  \"batch_size\": %u,\n  \"batch_count\": %u,\n  \"convert_size\": %u,\n  \"stream_bytes\": %llu,\n  \"results\": [",
+                  cpus, options->batch_size, options->batch_count, options->convert_size, ( unsigned long long ) ( stream_count * 3 * sizeof ( double ) ) );
+    }
+
+    threads = 1;
+    for ( ;; )
+    {
+        double stream_bytes_per_second = 0.0;
+        benchmark_workload workload;
+
+        for ( workload = benchmark_workload_stream; workload <= benchmark_workload_components; workload = ( benchmark_workload ) ( workload + 1 ) )
+        {
+            benchmark_scaling_result result;
+            uint64_t best = 0;
+            double items, bytes;
+            unsigned int repetition;
+
+            /* The merge of the labelled bands needs them to be equally wide, except for the last one. */
+            const uint32_t band_width = ( uint32_t ) ( ( options->convert_size + threads - 1 ) / threads );
+
+            for ( i = 0; i < threads; ++i )
+            {
+                uint64_t share_first, share_length;
+                benchmark_worker* worker = &workers[i];
+
+                memset ( worker, 0, sizeof ( *worker ) );
+                worker->workload = workload;
+                worker->cpu = options->cpu >= 0 ? ( int ) ( ( options->cpu + i ) % cpus ) : -1;
+                switch ( workload )
+                {
+                    case benchmark_workload_stream:
+                        benchmark_share ( stream_count, threads, i, &share_first, &share_length );
+                        worker->a = arrays;
+                        worker->b = arrays + stream_count;
+                        worker->c = arrays + stream_count * 2;
+                        worker->first = ( size_t ) share_first;
+                        worker->count = ( size_t ) share_length;
+                        break;
+                    case benchmark_workload_batch:
+                        benchmark_share ( options->batch_count, threads, i, &share_first, &share_length );
+                        worker->policy = policy;
+                        worker->size = options->batch_size;
+                        worker->first_job = ( uint32_t ) share_first;
+                        worker->job_count = ( uint32_t ) share_length;
+                        worker->buffer = batch_buffers + batch_buffer_size * i;
+                        worker->buffer_size = batch_buffer_size;
+                        break;
+                    case benchmark_workload_convert:
+                        benchmark_share ( options->convert_size, threads, i, &share_first, &share_length );
+                        worker->size = options->convert_size;
+                        worker->grid = grid;
+                        worker->first_column = ( uint32_t ) share_first;
+                        worker->column_count = ( uint32_t ) share_length;
+                        worker->output = output;
+                        worker->output_size = convert_output_size;
+                        break;
+                    default:
+                        worker->size = options->convert_size;
+                        worker->grid = grid;
+                        worker->first_column = ( uint32_t ) ( ( uint64_t ) band_width * i < options->convert_size ? band_width * i : options->convert_size );
+                        worker->column_count = options->convert_size - worker->first_column < band_width ? options->convert_size - worker->first_column : band_width;
+                        worker->labels = labels;
+                        break;
+                }
+            }
+            for ( repetition = 0; repetition < BENCHMARK_SCALING_REPETITIONS; ++repetition )
+            {
+                uint64_t elapsed = benchmark_run_workers ( workers, threads );
+                if ( elapsed != 0 && workload == benchmark_workload_components )
+                {
+                    const uint64_t start = benchmark_now_ns ();
+                    const uint64_t components = mazelib_merge_component_bands ( options->convert_size, options->convert_size, grid, band_width, labels, NULL );
+                    elapsed += benchmark_now_ns () - start;
+                    if ( components != 1 )
+                    {
+                        elapsed = 0;    /* A generated maze is a single component. */
+                    }
+                }
+                if ( elapsed == 0 )
+                {
+                    fprintf ( stderr, "The %s workload failed with %u threads.\n", benchmark_workload_names[workload], threads );
+                    goto done;
+                }
+                if ( best == 0 || elapsed < best )
+                {
+                    best = elapsed;
+                }
+            }
+
+            /* Bytes are counted the way STREAM does: every byte read or written once, without write allocation. */
+            switch ( workload )
+            {
+                case benchmark_workload_stream:
+                    items = ( double ) stream_count;
+                    bytes = ( double ) stream_count * 3 * sizeof ( double );
+                    break;
+                case benchmark_workload_batch:
+                    items = ( double ) options->batch_size * options->batch_size * options->batch_count;
+                    bytes = ( double ) batch_buffer_size * options->batch_count;
+                    break;
+                case benchmark_workload_convert:
+                    items = ( double ) convert_cells;
+                    bytes = ( double ) convert_cells + ( double ) convert_output_size;
+                    break;
+                default:
+                    items = ( double ) convert_cells;
+                    bytes = ( double ) convert_cells * ( 1 + sizeof ( uint32_t ) );
+                    break;
+            }
+
+            result.workload = workload;
+            result.threads = threads;
+            result.seconds = ( double ) best / 1e9;
+            if ( threads == 1 )
+            {
+                baseline[workload] = result.seconds;
+            }
+            result.speedup = baseline[workload] / result.seconds;
+            result.efficiency = result.speedup / threads;
+            result.items_per_second = items / result.seconds;
+            result.bytes_per_second = bytes / result.seconds;
+            if ( workload == benchmark_workload_stream )
+            {
+                stream_bytes_per_second = result.bytes_per_second;
+            }
+            result.stream_fraction = result.bytes_per_second / stream_bytes_per_second;
+            benchmark_print_scaling_result ( out, &result, options->format, first );
+            first = 0;
+        }
+
+        if ( threads == max_threads )
+        {
+            break;
+        }
+        threads = threads * 2 < max_threads ? threads * 2 : max_threads;
+    }
+
+    if ( options->format == benchmark_format_json )
+    {
+        fprintf ( out, "\n  ]\n}\n" );
+    }
+    status = 0;
+
+done:
+    free ( arrays );
+    free ( batch_buffers );
+    free ( labels );
+    free ( grid );
+    free ( output );
+    return status;
+}
+
+/* Measure every selected size, format and policy, writing the results to out. Returns 0 on success. */
+static int benchmark_sweep ( const benchmark_options* options, const benchmark_counters* counters, FILE* out )
+{
+    unsigned int size_index, policy_index;
+    int first = 1;
+    int status = 0;
+
+    if ( options->format == benchmark_format_json )
+    {
+        fprintf ( out, "{\n  \"seed\": %llu,\n  \"cpu\": %d,\n  \"results\": [", ( unsigned long long ) options->seed, options->cpu );
+    }
+
+    for ( size_index = 0; size_index < options->size_count; ++size_index )
+    {
+        const uint32_t size = options->sizes[size_index];
+        const uint64_t buffer_size = mazelib_get_required_buffer_size ( size, size, ( uint8_t ) options->blockwise );
+        uint8_t* buffer;
+        int blockwise;
+
+        if ( ( uint64_t ) size * size > options->max_cells )
+        {
+            fprintf ( stderr, "Skipping %ux%u, which is more than --max-cells.\n", size, size );
+            continue;
+        }
+
+        /* The blockwise buffer is the larger one, so it is used for both formats. */
+        buffer = ( uint8_t* ) malloc ( ( size_t ) buffer_size );
+        if ( buffer == NULL )
+        {
+            fprintf ( stderr, "Failed to allocate %llu bytes for %ux%u.\n", ( unsigned long long ) buffer_size, size, size );
+            status = 1;
+            continue;
+        }
+        for ( blockwise = 0; blockwise < 2; ++blockwise )
+        {
+            if ( ( blockwise && !options->blockwise ) || ( !blockwise && !options->compact ) )
+            {
+                continue;
+            }
+            for ( policy_index = 0; policy_index < BENCHMARK_POLICY_COUNT; ++policy_index )
+            {
+                benchmark_result result;
+
+                if ( ( options->policy_mask & ( 1 << policy_index ) ) == 0 )
+                {
+                    continue;
+                }
+                memset ( &result, 0, sizeof ( result ) );
+                result.width = size;
+                result.height = size;
+                result.blockwise = ( uint8_t ) blockwise;
+                result.policy = &benchmark_policies[policy_index];
+                if ( !benchmark_run_scenario ( &result, options, counters, buffer, mazelib_get_required_buffer_size ( size, size, ( uint8_t ) blockwise ) ) )
+                {
+                    fprintf ( stderr, "Generation failed for %ux%u.\n", size, size );
+                    status = 1;
+                    continue;
+                }
+                benchmark_print_result ( out, &result, options->format, options->perf, first );
+                first = 0;
+            }
+        }
+        free ( buffer );
+    }
+
+    if ( options->format == benchmark_format_json )
+    {
+        fprintf ( out, "\n  ]\n}\n" );
+    }
+    return status;
+}
+
+int main ( int argc, char** argv )
+{
+    benchmark_options options;
+    benchmark_counters counters;
+    FILE* out = stdout;
+    int status;
+
+    if ( !benchmark_parse_options ( argc, argv, &options ) )
+    {
+        benchmark_print_usage ();
+        return 1;
+    }
+    if ( options.mode == benchmark_mode_verify )
+    {
+        return benchmark_verify () != 0;
+    }
+    if ( options.mode == benchmark_mode_print_corpus )
+    {
+        return !benchmark_print_corpus ();
+    }
+    if ( options.mode != benchmark_mode_sweep && ( options.perf || options.trace_path ) )
+    {
+        /* The counters only follow the calling thread, and the tracer is not thread safe. */
+        fprintf ( stderr, "Warning: --perf and --trace only apply to the size sweep, and are ignored otherwise.\n" );
+        options.perf = 0;
+        options.trace_path = NULL;
+    }
+    if ( options.cpu >= 0 && !benchmark_pin_thread ( options.cpu ) )
+    {
+        fprintf ( stderr, "Warning: could not pin the benchmark to CPU %d.\n", options.cpu );
+    }
+    if ( options.perf && benchmark_open_counters ( &counters ) == 0 )
+    {
+        fprintf ( stderr, "Warning: no hardware counters are available, continuing without them.\n" );
+        options.perf = 0;
+    }
+    if ( options.trace_path )
+    {
+        benchmark_trace_start ();
+    }
+    if ( options.output_path )
+    {
+        out = fopen ( options.output_path, "w" );
+        if ( out == NULL )
+        {
+            fprintf ( stderr, "Could not open %s for writing.\n", options.output_path );
+            return 1;
+        }
+    }
+    if ( options.mode == benchmark_mode_scaling )
+    {
+        status = benchmark_scaling ( &options, out );
+    }
+    else if ( options.mode == benchmark_mode_prng )
+    {
+        status = benchmark_prng ( &options, out );
+    }
+    else
+    {
+        status = benchmark_sweep ( &options, options.perf ? &counters : NULL, out );
+    }
+
+    if ( out != stdout )
+    {
+        fclose ( out );
+    }
+    if ( options.perf )
+    {
+        benchmark_close_counters ( &counters );
+    }
+    if ( options.trace_path && !benchmark_trace_dump ( options.trace_path ) )
+    {
+        fprintf ( stderr, "Could not write the trace to %s.\n", options.trace_path );
+        status = 1;
+    }
+    return status;
+}
@@ -13,6 +13,7 @@
 * This ensures that given the same seed and configuration settings, the exact same maze will always be generated.
 *
 * The library has no global state, which means it can be used safely across multiple threads with a modicum of care.
+* The only exception is a pointer to a table of CPU specific kernels, which is resolved once on first use and never changes afterwards.
 *
 * The library does not allocate any dynamic memory.
 *
@@ -66,6 +67,35 @@
 * or by checking if the cell contains 0 or 1 for a blockwise maze.
 *
 * That's it! Refer to the API documentation below for more details.
+*
+* CPU DISPATCH
+*
+* On x86 and x86-64, the loops which convert a maze to the blockwise format, transform mazes and clear large grids are implemented in several variants (SSE2, AVX2 and AVX-512).
+* The fastest variant that is supported by the CPU and the operating system is selected at runtime the first time it is needed,
+* so a single binary runs on every machine without having to be recompiled.
+* Every variant produces byte for byte identical results.
+* Define MAZELIB_NO_SIMD before including the implementation to only use the portable C code.
+*
+* Grids of at least MAZELIB_STREAMING_THRESHOLD bytes (32 MiB by default) are cleared with non-temporal stores, which go straight to memory.
+* This roughly doubles the speed of clearing multi-gigabyte grids, since the memory does not have to be read first, and leaves the rest of the cache alone.
+* Smaller grids are cleared with memset, so that they are still in the cache when generation starts. Define MAZELIB_STREAMING_THRESHOLD before including the implementation to change the threshold.
+*
+* STATISTICS
+*
+* Define MAZELIB_STATS before including this file to have the library count what it does while generating a maze.
+* This is meant for finding out why a particular configuration is slow, for example how much time goes into removing cells from the middle of the list.
+* The counters are stored in the prng (see mazelib_stats below), so MAZELIB_STATS must be defined the same way in every file that includes mazelib.h.
+* When it is not defined, the counters and the code that updates them are compiled out entirely.
+* Only the C functions update the counters. The inlined C++ interface in mazelib.hpp does not.
+*
+* TRACING
+*
+* The implementation marks the beginning and end of each phase of its work with the macros MAZELIB_TRACE_BEGIN ( phase ) and MAZELIB_TRACE_END ( phase ),
+* where phase is one of the string literals "clear", "carve", "stamp", "blockwise", "distances" or "components".
+* By default they expand to nothing. Define them before including the implementation to hook them up to a profiler or tracer of your own,
+* for example one that records timestamps. benchmark.c contains such a tracer, which writes the Chrome trace event format.
+* Each BEGIN is matched by an END on the same thread, and phases on one thread never overlap.
+* If the library is used from several threads at once, the hooks are called from those threads too, so they must be thread safe in that case.
 */
 
 #ifndef MAZELIB_H
@@ -87,6 +117,12 @@ extern "C" {
 #define mazelib_north 4
 #define mazelib_south 8
 
+    /* The distance reported for cells which can not be reached */
+#define mazelib_unreachable 0xffffffffu
+
+    /* The value of the blocks of a blockwise maze that lie on a path drawn by mazelib_convert_to_blockwise_with_path */
+#define mazelib_path_block 2
+
     /* COMMON FUNCTIONS */
 
     /* These functions are useful when working with both the low and the high level API. */
@@ -100,6 +136,53 @@ extern "C" {
     /* Return the byte offset for a cell given a set of coordinates and the height of the maze. */
     uint64_t mazelib_get_cell_index ( uint32_t x, uint32_t y, uint32_t height );
 
+    /*
+    * Ask the operating system to back a large buffer with huge pages, which cuts down on TLB misses when generating very large mazes.
+    * Call it right after allocating the buffer and before anything is written to it. Only the whole 2 MiB blocks inside the buffer are affected.
+    * This uses madvise(MADV_HUGEPAGE) on Linux, and does nothing elsewhere.
+    * The function returns 1 if the advice was given, or 0 if it was not (because the platform does not support it, or the buffer does not cover a whole block).
+    */
+    uint8_t mazelib_advise_huge_pages ( void* buffer, uint64_t size );
+
+    /*
+    * Convert a maze from the compact format to the blockwise format.
+    *
+    * grid - A maze in the compact format, using width*height bytes.
+    *
+    * output - A buffer with room for at least ((width*2)+1)*((height*2)+1) bytes. It must not overlap grid.
+    *
+    * output_size - The amount of space in output, in bytes.
+    *
+    * The function returns the number of bytes written to output, or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_convert_to_blockwise ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* output, uint64_t output_size );
+
+    /*
+    * Convert a band of columns of a maze from the compact format to the blockwise format.
+    *
+    * This writes the part of the output of mazelib_convert_to_blockwise that belongs to the columns first_column...first_column+column_count (exclusive),
+    * which is blockwise columns (first_column*2)+1 through (first_column+column_count)*2. The band that starts at column 0 also writes the western border.
+    * Bands that do not overlap never write to the same bytes, so a large maze can be converted by several threads at once, each with its own band.
+    *
+    * grid, output and output_size are the same as for mazelib_convert_to_blockwise, and always refer to the whole maze.
+    *
+    * The function returns the size of the whole blockwise maze in bytes, or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_convert_columns_to_blockwise ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t first_column, uint32_t column_count, uint8_t* output, uint64_t output_size );
+
+    /*
+    * Convert a maze to the blockwise format like mazelib_convert_to_blockwise and mazelib_convert_columns_to_blockwise, and draw a path into it at the same time.
+    * Each column is finished while it is still in the cache, which saves a separate pass over the whole output.
+    *
+    * path - A bit for each cell of the maze, in the order of mazelib_get_cell_index, where cell i is bit i%8 of byte i/8. It needs (width*height+7)/8 bytes.
+    * mazelib_mark_path fills it in from the distances to a starting cell.
+    *
+    * The blocks of the marked cells become mazelib_path_block, and so do the gaps between two marked cells which a passage joins.
+    * If path is NULL, these functions are the same as the ones without a path.
+    */
+    uint64_t mazelib_convert_to_blockwise_with_path ( uint32_t width, uint32_t height, const uint8_t* grid, const uint8_t* path, uint8_t* output, uint64_t output_size );
+    uint64_t mazelib_convert_columns_to_blockwise_with_path ( uint32_t width, uint32_t height, const uint8_t* grid, const uint8_t* path, uint32_t first_column, uint32_t column_count, uint8_t* output, uint64_t output_size );
+
     /* HIGH LEVEL API */
 
     /* Generate a maze using the high level API.
@@ -145,11 +228,36 @@ extern "C" {
     * When you are ready to generate your maze, call mazelib_generate_extended.
     */
 
+#ifdef MAZELIB_STATS
+
+    /*
+    * Generation statistics, only available when MAZELIB_STATS is defined.
+    *
+    * They are reset by mazelib_prng_seed and at the beginning of mazelib_generate_extended and the other generation functions which take a prng,
+    * so after a call to one of them they describe that call, including the random numbers drawn by the cell selection callback.
+    */
+    typedef struct mazelib_stats mazelib_stats;
+    struct mazelib_stats
+    {
+        uint64_t steps; /* Iterations of the main loop, each of which either carves a passage or removes a cell. */
+        uint64_t dead_end_removals; /* Cells removed from the list because they had no unvisited neighbors. */
+        uint64_t memmove_bytes; /* Bytes moved to close the gaps left by removed cells. */
+        uint64_t prng_draws; /* Calls to mazelib_prng_next, including those made by mazelib_prng_next_in_range. */
+        uint64_t rejection_retries; /* Numbers thrown away by mazelib_prng_next_in_range to avoid bias. */
+        uint64_t callback_calls; /* Invocations of the cell selection callback. */
+        uint64_t max_frontier; /* The largest number of cells that were in the list at the same time. */
+    };
+
+#endif
+
     /* PRNG */
     typedef struct mazelib_prng mazelib_prng;
     struct mazelib_prng
     {
         uint64_t s[4];
+#ifdef MAZELIB_STATS
+        mazelib_stats stats;
+#endif
     };
 
     /* Seed the PRNG from a 64 bit unsigned integer. */
@@ -207,6 +315,419 @@ extern "C" {
     */
     uint64_t mazelib_generate_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size );
 
+    /* MEMORY ACCOUNTING */
+
+    /*
+    * A breakdown of the memory used to generate a maze.
+    *
+    * The buffer given to the generator holds both the final output and temporary storage.
+    * The temporary storage consists of the grid (which is the output itself for compact mazes, and sits at the end of the buffer for blockwise ones)
+    * and the list of cells, which sits at the beginning of the buffer for blockwise mazes and right after the grid for compact ones.
+    * The list can in the worst case hold every cell of the maze, but usually holds far fewer, so the end of its space is often never touched.
+    */
+    typedef struct mazelib_memory_report mazelib_memory_report;
+    struct mazelib_memory_report
+    {
+        uint64_t output_bytes; /* The size of the final maze. */
+        uint64_t scratch_bytes; /* The space needed on top of the output, which is the worst case size of the list of cells. */
+        uint64_t buffer_bytes; /* The size of the buffer to allocate, output_bytes+scratch_bytes. This is what mazelib_get_required_buffer_size returns. */
+        uint64_t frontier_high_water; /* The largest number of cells in the list. Before generation this is the worst case, width*height. */
+        uint64_t peak_resident_bytes; /* The number of bytes of the buffer that are ever read or written. Pages beyond these are never touched. */
+        uint64_t bytes_touched; /* An estimate of the memory traffic in bytes, counting every read and write of the grid, the list and the output. */
+    };
+
+    /*
+    * Describe the memory that generating a maze of the given dimensions and format will use, assuming the worst case for the list of cells.
+    *
+    * cell_bytes - The size of each entry in the list of cells. Pass 0 for the size that the C library picks for the dimensions.
+    * The C++ interface in mazelib.hpp can be told to use a fixed size instead (its Layout parameter), in which case pass that size (1, 2, 4 or 8).
+    *
+    * The estimate of bytes_touched assumes that every step examines all four neighbors of its cell,
+    * and does not include the cost of removing cells from the middle of the list, which depends on the cell selection callback.
+    * mazelib_generate_extended_with_report measures both the real size of the list and the bytes it moved.
+    *
+    * The function returns buffer_bytes, or 0 if the dimensions are invalid or cell_bytes is not 0, 1, 2, 4 or 8 or is too small for the number of cells.
+    */
+    uint64_t mazelib_get_memory_report ( uint32_t width, uint32_t height, uint8_t blockwise, uint8_t cell_bytes, mazelib_memory_report* report );
+
+    /*
+    * Exactly like mazelib_generate_extended, but also fills report with the memory that was actually used.
+    * frontier_high_water and peak_resident_bytes reflect the real size of the list, and bytes_touched includes the bytes moved to remove cells from it.
+    * If report is NULL, this is the same as calling mazelib_generate_extended. The report is left untouched if generation fails.
+    */
+    uint64_t mazelib_generate_extended_with_report ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size, mazelib_memory_report* report );
+
+    /* SYMMETRIC MAZES */
+
+    /*
+    * These functions generate mazes that look the same after being mirrored or turned upside down, which is useful for example for fair maps for two or four players.
+    * The maze is still perfect: there is exactly one path between any two cells.
+    *
+    * Only the cells in one half (or one quarter) of the maze are chosen by the growing tree algorithm, and every passage is carved together with its mirror images,
+    * so generation does half (or a quarter) of the usual work.
+    *
+    * The symmetry is one of the following values:
+    * mazelib_symmetry_mirror_x - The west half mirrors the east half.
+    * mazelib_symmetry_mirror_y - The north half mirrors the south half.
+    * mazelib_symmetry_mirror_both - Both of the above at once, so that all four quarters mirror each other.
+    * mazelib_symmetry_rotate_180 - The maze looks the same when turned upside down.
+    *
+    * A perfect maze can only have a symmetry if it has a cell or a passage which the symmetry leaves in place, and this has some consequences:
+    * 1. If a mirror axis runs through the middle of a row or column of cells (because the width or height is odd), the cells on that axis form a straight passage.
+    * 2. If a mirror axis runs between two columns (or rows), there is exactly one passage across it.
+    * 3. mazelib_symmetry_rotate_180 is impossible when both the width and the height are even, and so is mazelib_symmetry_mirror_both.
+    * In the impossible cases the functions return 0.
+    *
+    * The buffer is the same as for mazelib_generate and mazelib_generate_extended, see mazelib_get_required_buffer_size.
+    */
+#define mazelib_symmetry_mirror_x 1
+#define mazelib_symmetry_mirror_y 2
+#define mazelib_symmetry_mirror_both 3
+#define mazelib_symmetry_rotate_180 4
+
+    /* Generate a symmetric maze using the high level API. The parameters are the same as for mazelib_generate, with the addition of symmetry. */
+    uint64_t mazelib_generate_symmetric ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, uint8_t symmetry, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /*
+    * Generate a symmetric maze using the low level API. The parameters are the same as for mazelib_generate_extended, with the addition of symmetry.
+    * The cell selection callback only ever sees the cells on one side of the axes (and the cells on the axes themselves).
+    */
+    uint64_t mazelib_generate_symmetric_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t symmetry, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /* WAYPOINTS */
+
+    /*
+    * These functions generate a maze in which the path from the first waypoint to the last one passes through all of the others in the given order,
+    * for example to make the solution lead through a treasure room.
+    *
+    * A route through the waypoints is carved first, and the rest of the maze is then grown around it with the usual cell selection.
+    * Nothing else ever connects two cells of the route, so the route is the only path between its ends.
+    *
+    * The legs of the route are carved one at a time, the short ones first, each along a random shortest path that keeps clear of the rest of the route where it can.
+    * After each leg, one flood of the maze checks that the legs still missing can reach their waypoints, and a leg that would cut one off is carved another way.
+    * This needs no memory beyond the output, and each attempt costs a couple of searches of the maze per waypoint. If a leg finds no way at all, the route is
+    * started over, up to 8 times.
+    *
+    * The parameters are the same as for mazelib_generate and mazelib_generate_extended, with the addition of:
+    * waypoints - An array of waypoint_count*2 coordinates: the x and then the y of each waypoint.
+    * waypoint_count - The number of waypoints, at least 1.
+    *
+    * The functions return 0 if a waypoint is outside the maze or given twice, or if the order of the waypoints can not be routed. Some orders are turned away
+    * before any search: a waypoint with fewer free sides than it has legs, waypoints out of order in a maze one cell wide, and waypoints on the border in an
+    * order that would make the route cross itself. Otherwise the functions return 0 when every attempt fails, which can also happen when a route exists:
+    * routing through waypoints in a fixed order is a hard problem in general. Waypoints that are far apart compared to their number are nearly always routed,
+    * for example 10 random waypoints on 50x50 cells in more than 9 of 10 cases, but a dozen or more crowded together often are not.
+    */
+    uint64_t mazelib_generate_with_waypoints ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+    uint64_t mazelib_generate_with_waypoints_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /* COMPLETION */
+
+    /*
+    * These functions turn a partially carved maze (for example one edited by hand) into a perfect maze, keeping every passage that is already there.
+    * On entry, the first width*height bytes of output hold the partial maze in the compact format, whether or not blockwise output is requested.
+    * Cells joined by carved passages are treated as one, and the growing tree algorithm connects these groups with the usual cell selection.
+    *
+    * The parameters are the same as for mazelib_generate and mazelib_generate_extended, with the addition of:
+    * locked_walls - A mask in the compact format. A set direction bit means that the wall on that side of the cell must stay, and it is enough to set it on one of the two cells.
+    * Pass NULL if no walls are locked.
+    *
+    * The functions return 0 if the constraints can not be met: if a passage is only carved on one side or leads out of the maze,
+    * if a passage goes through a locked wall, if the carved passages form a loop, or if the locked walls keep some cells out of reach of the others.
+    * All of these are found before any carving, with a few passes over the maze.
+    * On failure the contents of output are undefined, so keep a copy of the partial maze if it is needed afterwards.
+    */
+    uint64_t mazelib_complete ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, const uint8_t* locked_walls, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+    uint64_t mazelib_complete_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, const uint8_t* locked_walls, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /* TILED MAZES */
+
+    /*
+    * These functions fill large areas with mazes much faster than the growing tree algorithm can, at the cost of some randomness.
+    * A library of small square mazes (tiles) is generated once. A tiled maze is then a coarse maze with one cell per tile,
+    * where every tile is a copy of a random tile from the library and every passage of the coarse maze opens one wall at a random place along the shared edge.
+    * Since each tile is a perfect maze and the coarse maze is a tree, the result is a perfect maze as well.
+    * Most of the work is copying columns of tiles, so the speed is close to that of memcpy. The repetition can be seen up close, so this is best suited to background filler.
+    */
+
+    /* Get the size in bytes of a library of variants tiles of tile_size by tile_size cells, including the room needed while building it. Returns 0 if the arguments are invalid. */
+    uint64_t mazelib_get_tile_library_size ( uint32_t tile_size, uint32_t variants );
+
+    /*
+    * Build a library of tiles, with the same parameters as mazelib_generate and mazelib_generate_extended.
+    * The tiles are stored one after the other in the compact format, so tile i begins at library + i * tile_size * tile_size.
+    * tile_size must be at least 2. The return value is the number of bytes used by the tiles, or 0 if the arguments are invalid.
+    */
+    uint64_t mazelib_build_tile_library ( uint32_t tile_size, uint32_t variants, uint64_t random_seed, int8_t random_threshold_percent, uint8_t* library, uint64_t library_size );
+    uint64_t mazelib_build_tile_library_extended ( uint32_t tile_size, uint32_t variants, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t* library, uint64_t library_size );
+
+    /*
+    * Generate a maze from a library of tiles. width and height must be multiples of tile_size.
+    * The output buffer is sized with mazelib_get_required_buffer_size as usual, and the coarse maze is generated in the part of it that holds the list.
+    * The remaining parameters are the same as for mazelib_generate and mazelib_generate_extended, and they only shape the coarse maze.
+    * Returns 0 if the arguments are invalid.
+    */
+    uint64_t mazelib_generate_tiled ( uint32_t width, uint32_t height, const uint8_t* library, uint32_t tile_size, uint32_t variants, uint64_t random_seed, int8_t random_threshold_percent, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+    uint64_t mazelib_generate_tiled_extended ( uint32_t width, uint32_t height, const uint8_t* library, uint32_t tile_size, uint32_t variants, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /* RECORDING AND REPLAY */
+
+    /*
+    * A log of the passages carved while generating a maze, in the order they were carved, for animating the generation or finding out which parts of a maze came first.
+    *
+    * The log starts with the first cell as a variable length integer (7 bits per byte, least significant first).
+    * Each passage then takes one byte: the direction (0 west, 1 east, 2 north, 3 south) in the low 2 bits,
+    * and in the upper 6 bits how far the cell it was carved from lies from the cell reached by the previous passage.
+    * The distance is a difference of cell indices with the sign folded into the lowest bit. If it does not fit in 6 bits, the upper bits are all set and the rest follows as a variable length integer.
+    * When the same cell keeps being extended (low thresholds), or a recent cell is picked again, every passage takes exactly one byte.
+    *
+    * Set up the fields marked as inputs before generating. The recorder fills in the rest.
+    */
+    typedef struct mazelib_carve_log mazelib_carve_log;
+    struct mazelib_carve_log
+    {
+        uint8_t* data; /* Input: the buffer for the log. mazelib_get_carve_log_size gives a size that is always enough. */
+        uint64_t capacity; /* Input: the size of data in bytes. Generation fails if the log does not fit. */
+        uint64_t* keyframes; /* Input: optional, room for keyframe_capacity keyframes of two values each, the offset of a passage in data and the cell reached just before it. */
+        uint64_t keyframe_capacity; /* Input: the number of keyframes that fit. Keyframes past the end are simply not recorded. */
+        uint64_t keyframe_interval; /* Input: the number of passages between keyframes. 0 records no keyframes. */
+        uint32_t* visit_order; /* Input: optional, width*height entries which receive the number of the passage that reached each cell. The first cell gets 0. */
+        uint64_t size; /* The number of bytes of data used. */
+        uint64_t events; /* The number of passages, which is width*height-1 for a complete maze. */
+        uint64_t keyframe_count; /* The number of keyframes recorded. */
+        uint64_t last_cell; /* The cell reached by the last passage. */
+    };
+
+    /* Get a log size which is enough for any maze with the given dimensions. Typical logs need little more than one byte per cell. */
+    uint64_t mazelib_get_carve_log_size ( uint32_t width, uint32_t height );
+
+    /*
+    * Generate a maze like mazelib_generate and mazelib_generate_extended, recording every passage in log.
+    * The mazes are the same as those of mazelib_generate and mazelib_generate_extended for the same arguments.
+    * Returns 0 if log is NULL or too small, or if visit_order is given for a maze of 2^32 cells or more, as well as in the usual cases.
+    */
+    uint64_t mazelib_generate_recorded ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, mazelib_carve_log* log, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+    uint64_t mazelib_generate_recorded_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, mazelib_carve_log* log, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /*
+    * Replay of a log into a maze in the compact format, without running the generator again.
+    * A replay can move to any number of passages in either direction. Going forward applies the passages in between.
+    * Going back removes them again, and has to decode the log from the keyframe at or before the target, or from the start if there are no keyframes.
+    */
+    typedef struct mazelib_replay mazelib_replay;
+    struct mazelib_replay
+    {
+        const mazelib_carve_log* log; /* The log being replayed. It must stay valid while the replay is used. */
+        uint8_t* grid; /* The maze being replayed into, width*height bytes. */
+        uint32_t height; /* The height of the maze. */
+        uint64_t event; /* The number of passages carved so far. */
+        uint64_t offset; /* The offset in the log of the next passage. */
+        uint64_t last_cell; /* The cell reached by the last passage carved so far, or the first cell. Handy for drawing a cursor. */
+    };
+
+    /* Start a replay with an empty grid, before the first passage. Returns 0 if any argument is invalid. */
+    uint8_t mazelib_replay_begin ( mazelib_replay* replay, const mazelib_carve_log* log, uint32_t width, uint32_t height, uint8_t* grid );
+
+    /* Move the replay to the state after the given number of passages, or to the end of the log if there are not that many. Returns the number of passages now carved. */
+    uint64_t mazelib_replay_seek ( mazelib_replay* replay, uint64_t event );
+
+    /* FRONTIER AWARE SELECTION */
+
+    /*
+    * A read-only view of the list of cells (the frontier) and of the grid, for cell selection callbacks that need to know where the cells are,
+    * for example to prefer the cell closest to an exit. The view points into the generator's own buffer, so nothing has to be copied or mirrored.
+    *
+    * The list holds cell indices (see mazelib_get_cell_index) of cell_bytes bytes each. Use the member of cells that matches cell_bytes, or mazelib_get_frontier_cell.
+    * In the grid, cells which have been reached are nonzero, and their set bits are the passages carved so far.
+    * Both only stay valid during the callback, and must not be written to.
+    */
+    typedef struct mazelib_frontier_view mazelib_frontier_view;
+    struct mazelib_frontier_view
+    {
+        union
+        {
+            const uint8_t* u8;
+            const uint16_t* u16;
+            const uint32_t* u32;
+            const uint64_t* u64;
+        } cells; /* The list of cells, oldest first. */
+        uint64_t count; /* The number of cells in the list. */
+        uint8_t cell_bytes; /* The size of each entry: 1, 2, 4 or 8. */
+        const uint8_t* grid; /* The maze so far, in the compact format. */
+        uint32_t width; /* The dimensions of the maze. */
+        uint32_t height;
+    };
+
+    /* Like mazelib_cell_selection_callback, but with the whole frontier instead of just its size. Return an index below frontier->count, or anything else to abort. */
+    typedef uint64_t ( *mazelib_frontier_selection_callback ) ( const mazelib_frontier_view* frontier, mazelib_prng* prng, void* user );
+
+    /* Get the cell index stored at position index in the list, whatever the size of the entries. */
+    uint64_t mazelib_get_frontier_cell ( const mazelib_frontier_view* frontier, uint64_t index );
+
+    /* Generate a maze exactly like mazelib_generate_extended, but with a callback which sees the frontier. A callback which only looks at count generates the same mazes. */
+    uint64_t mazelib_generate_with_frontier ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_frontier_selection_callback frontier_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size );
+
+    /* ANALYSIS */
+
+    /* These functions examine a maze in the compact format after it has been generated (or edited). */
+
+    /*
+    * Compute the length of the shortest path from a starting cell to every other cell, with a breadth first search.
+    *
+    * A move is possible in every direction whose bit is set in the cell being left, as long as it does not lead outside the maze.
+    *
+    * The parameters are:
+    * width, height - The dimensions of the maze. width*height must be less than 4294967295 (mazelib_unreachable).
+    *
+    * grid - The maze in the compact format.
+    *
+    * start_x, start_y - The cell to measure from.
+    *
+    * distances - An array of width*height elements which receives the number of steps to each cell, or mazelib_unreachable for cells that can not be reached.
+    * It is indexed just like the maze, see mazelib_get_cell_index.
+    *
+    * scratch - Temporary storage of width*height elements. Its contents are undefined afterwards.
+    *
+    * The function returns the number of cells that can be reached from the starting cell (including the starting cell itself), or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_get_distances ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t start_x, uint32_t start_y, uint32_t* distances, uint32_t* scratch );
+
+    /*
+    * Mark a shortest path from the starting cell of mazelib_get_distances to the cell end_x, end_y in a bit set like the one taken by mazelib_convert_to_blockwise_with_path.
+    * The path is found by stepping back to a neighbor one step closer until the distance is 0, so it takes time in proportion to its length.
+    * Bits are only ever set, so clear path first, or leave earlier paths in it to draw several at once.
+    * The function returns the number of cells on the path, or 0 if the end can not be reached or any of the parameters are invalid.
+    */
+    uint64_t mazelib_mark_path ( uint32_t width, uint32_t height, const uint8_t* grid, const uint32_t* distances, uint32_t end_x, uint32_t end_y, uint8_t* path );
+
+    /*
+    * Find the groups of cells which can be reached from each other (the connected components), for example after a maze has been edited or masked.
+    * A generated maze always has a single component.
+    *
+    * Unlike mazelib_get_distances, a passage only connects two cells if both of them have the bit for it set, so that a wall can be added by clearing the bit on either side.
+    *
+    * The parameters are:
+    * width, height - The dimensions of the maze. width*height must be less than 4294967295 (mazelib_unreachable).
+    *
+    * grid - The maze in the compact format.
+    *
+    * labels - An array of width*height elements which receives the component of every cell, numbered from 0 in the order in which the components are first met
+    * (going down each column, starting with the westernmost). It is indexed just like the maze, see mazelib_get_cell_index.
+    *
+    * sizes - An array which receives the number of cells in each component, or NULL. It must be large enough for the number of components, which is at most width*height.
+    *
+    * The function returns the number of components, or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_label_components ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t* labels, uint32_t* sizes );
+
+    /*
+    * The two halves of mazelib_label_components, for spreading the work of a large maze over several threads.
+    *
+    * mazelib_label_component_band connects the cells in a band of columns, ignoring the passages which lead west out of the band.
+    * It only writes the part of labels that belongs to the band, so different bands can be processed at the same time.
+    * Afterwards labels holds intermediate values, which are only meaningful to mazelib_merge_component_bands.
+    * The function returns the number of components within the band, or 0 if any of the parameters are invalid (including a column_count of 0).
+    *
+    * Once every band has been processed, mazelib_merge_component_bands connects the bands to each other and produces the same labels and sizes as mazelib_label_components.
+    * The bands must start at the columns which are multiples of band_width, so that all but the last one are band_width columns wide.
+    * It returns the number of components, or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_label_component_band ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t first_column, uint32_t column_count, uint32_t* labels );
+    uint64_t mazelib_merge_component_bands ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t band_width, uint32_t* labels, uint32_t* sizes );
+
+    /*
+    * Measure how much traffic every passage and cell of a perfect maze carries, for example to place guards or items at the chokepoints.
+    * The betweenness of a passage or cell is the number of pairs of cells whose path goes through it.
+    * In a perfect maze this is found in linear time from the sizes of the subtrees on either side, without any path searches.
+    *
+    * Passages are counted the same way as in mazelib_label_components.
+    *
+    * The parameters are:
+    * width, height - The dimensions of the maze. width*height must be less than 4294967295 (mazelib_unreachable).
+    *
+    * grid - The maze in the compact format.
+    *
+    * passages - An array of width*height*2 elements, or NULL. Element cell*2 receives the betweenness of the passage to the east of a cell, and element cell*2+1 that of the passage to the south,
+    * where cell is the index given by mazelib_get_cell_index. Both are 0 where there is no passage.
+    *
+    * cells - An array of width*height elements, or NULL, which receives the betweenness of each cell. Pairs which start or end at a cell are not counted for it.
+    *
+    * scratch - Temporary storage of width*height*3 elements. Its contents are undefined afterwards.
+    *
+    * The function returns the number of cells, or 0 if any of the parameters are invalid or the maze is not perfect (it has loops or cells that can not be reached).
+    */
+    uint64_t mazelib_get_tree_betweenness ( uint32_t width, uint32_t height, const uint8_t* grid, uint64_t* passages, uint64_t* cells, uint32_t* scratch );
+
+    /*
+    * Find the chokepoints of any maze, including braided mazes with loops: the cells (articulation points) and passages (bridges)
+    * whose removal would cut some cells off from each other.
+    * In a perfect maze every passage is a bridge and every cell that is not a dead end is an articulation point.
+    *
+    * The search is a depth first search with an explicit stack (Tarjan's algorithm), so it works on mazes of any size.
+    * Passages are counted the same way as in mazelib_label_components.
+    *
+    * The parameters are:
+    * width, height - The dimensions of the maze. width*height must be less than 4294967295 (mazelib_unreachable).
+    *
+    * grid - The maze in the compact format.
+    *
+    * articulation_points - An array of width*height bytes which receives 1 for every articulation point and 0 for every other cell.
+    *
+    * bridges - An array of width*height bytes which receives a maze in the compact format that only contains the bridges.
+    *
+    * scratch - Temporary storage of width*height*3 elements. Its contents are undefined afterwards.
+    *
+    * The function returns the number of cells, or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_get_chokepoints ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* articulation_points, uint8_t* bridges, uint32_t* scratch );
+
+    /* TRANSFORMS */
+
+    /*
+    * These functions rotate and mirror mazes in the compact format, with the direction bits of every cell changed to match.
+    * The eight transforms below are all the ways of turning a rectangle onto itself, including flipping it over.
+    * The rotations are clockwise, and the transforms which turn the maze by a quarter swap its width and height.
+    */
+#define mazelib_transform_identity 0
+#define mazelib_transform_rotate_90 1
+#define mazelib_transform_rotate_180 2
+#define mazelib_transform_rotate_270 3
+#define mazelib_transform_mirror_x 4
+#define mazelib_transform_mirror_y 5
+#define mazelib_transform_transpose 6
+#define mazelib_transform_anti_transpose 7
+
+    /*
+    * Transform a maze in the compact format.
+    *
+    * The parameters are:
+    * width, height - The dimensions of the maze before the transform.
+    *
+    * grid - The maze in the compact format.
+    *
+    * transform - One of the mazelib_transform values.
+    *
+    * output - A buffer of at least width*height bytes which receives the transformed maze. It must not overlap the grid.
+    *
+    * output_size - The size of the output buffer in bytes.
+    *
+    * The function returns the number of bytes written, or 0 if any of the parameters are invalid.
+    * Bits other than the four direction bits are copied unchanged.
+    */
+    uint64_t mazelib_transform ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t transform, uint8_t* output, uint64_t output_size );
+
+    /*
+    * Compute a hash of a maze in the compact format which is the same for all of its rotations and reflections, for example to find duplicates in a collection of mazes.
+    *
+    * Of the eight transformed mazes, those which are no wider than they are tall are compared cell by cell in the order of mazelib_transform's output,
+    * and the first one which is smallest is hashed together with its dimensions (64 bit FNV-1a).
+    * The transformed mazes are never written out, and in practice all but one of them are ruled out after the first few cells.
+    *
+    * If transform is not NULL, it receives the transform which produced the hashed maze, so passing it to mazelib_transform gives the canonical form itself.
+    * The function returns the hash, or 0 if any of the parameters are invalid.
+    */
+    uint64_t mazelib_get_canonical_hash ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* transform );
+
 #ifdef __cplusplus
 }
 #endif
@@ -215,12 +736,56 @@ extern "C" {
 
 /* IMPLEMENTATION */
 
-#ifdef MAZELIB_IMPLEMENTATION
+/* The implementation is guarded separately, so that this file can be included again (for example by mazelib.hpp) in the file which defines MAZELIB_IMPLEMENTATION. */
+#if defined(MAZELIB_IMPLEMENTATION) && !defined(MAZELIB_IMPLEMENTATION_INCLUDED)
+#define MAZELIB_IMPLEMENTATION_INCLUDED
 
 #include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
+#ifndef MAZELIB_NO_SIMD
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER) || defined(__clang__) || ( defined(__GNUC__) && __GNUC__ >= 5 )
+#define MAZELIB_X86_DISPATCH
+#endif
+#endif
+#endif
+
+#ifndef MAZELIB_STREAMING_THRESHOLD
+#define MAZELIB_STREAMING_THRESHOLD ( ( uint64_t ) 32 << 20 )
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#ifdef MAZELIB_STATS
+#define MAZELIB_STATS_ADD(prng, counter, amount) ( ( prng )->stats.counter += ( amount ) )
+#define MAZELIB_STATS_MAX(prng, counter, value) ( ( prng )->stats.counter = ( prng )->stats.counter < ( value ) ? ( value ) : ( prng )->stats.counter )
+#else
+#define MAZELIB_STATS_ADD(prng, counter, amount) ( ( void ) 0 )
+#define MAZELIB_STATS_MAX(prng, counter, value) ( ( void ) 0 )
+#endif
+
+#ifndef MAZELIB_TRACE_BEGIN
+#define MAZELIB_TRACE_BEGIN(phase) ( ( void ) 0 )
+#endif
+#ifndef MAZELIB_TRACE_END
+#define MAZELIB_TRACE_END(phase) ( ( void ) 0 )
+#endif
+
+#ifdef MAZELIB_X86_DISPATCH
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MAZELIB_TARGET(features)
+#else
+#include <cpuid.h>
+#define MAZELIB_TARGET(features) __attribute__ ( ( target ( features ) ) )
+#endif
+#endif
+
 static uint8_t mazelib_get_cell_bytes_required_for_dimensions ( uint32_t width, uint32_t height )
 {
     uint64_t temp = width;
@@ -287,6 +852,9 @@ void mazelib_prng_seed ( mazelib_prng* prng, uint64_t x )
         z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111eb;
         prng->s[i] = z ^ ( z >> 31 );
     }
+#ifdef MAZELIB_STATS
+    memset ( &prng->stats, 0, sizeof ( prng->stats ) );
+#endif
 }
 
 static uint64_t mazelib_prng_rotl ( const uint64_t x, int k )
@@ -301,6 +869,8 @@ uint64_t mazelib_prng_next ( mazelib_prng* prng )
 
     const uint64_t t = s[1] << 17;
 
+    MAZELIB_STATS_ADD ( prng, prng_draws, 1 );
+
     s[2] ^= s[0];
     s[3] ^= s[1];
     s[1] ^= s[2];
@@ -315,13 +885,14 @@ uint64_t mazelib_prng_next ( mazelib_prng* prng )
 
 uint64_t mazelib_prng_next_in_range ( mazelib_prng* prng, uint64_t range )
 {
-    uint64_t x, r;
-    do
+    uint64_t x = mazelib_prng_next ( prng );
+    uint64_t r = x % range;
+    while ( x - r > -range )
     {
+        MAZELIB_STATS_ADD ( prng, rejection_retries, 1 );
         x = mazelib_prng_next ( prng );
         r = x % range;
     }
-    while ( x - r > -range );
     return r;
 }
 
@@ -330,6 +901,40 @@ uint64_t mazelib_get_cell_index ( uint32_t x, uint32_t y, uint32_t height )
     return ( ( uint64_t ) x * ( uint64_t ) height ) + ( uint64_t ) y;
 }
 
+uint8_t mazelib_advise_huge_pages ( void* buffer, uint64_t size )
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    const size_t block = ( size_t ) 2 << 20;
+    const size_t start = ( ( size_t ) buffer + block - 1 ) & ~ ( block - 1 );
+    const size_t end = ( ( size_t ) buffer + ( size_t ) size ) & ~ ( block - 1 );
+
+    if ( buffer == NULL || end <= start )
+    {
+        return 0;
+    }
+    return ( uint8_t ) ( madvise ( ( void* ) start, end - start, MADV_HUGEPAGE ) == 0 );
+#else
+    ( void ) buffer;
+    ( void ) size;
+    return 0;
+#endif
+}
+
+static uint64_t mazelib_read_cell ( const uint8_t* mem, uint8_t cell_bytes, uint64_t cell_index )
+{
+    switch ( cell_bytes )
+    {
+        case 1:
+            return mem[cell_index];
+        case 2:
+            return ( ( const uint16_t* ) mem ) [cell_index];
+        case 4:
+            return ( ( const uint32_t* ) mem ) [cell_index];
+        default:
+            return ( ( const uint64_t* ) mem ) [cell_index];
+    };
+}
+
 static void mazelib_assign_cell ( uint8_t* mem, uint8_t cell_bytes, uint64_t cell_index, uint64_t value )
 {
     switch ( cell_bytes )
@@ -360,295 +965,3571 @@ static void mazelib_assign_cell ( uint8_t* mem, uint8_t cell_bytes, uint64_t cel
     };
 }
 
-uint64_t mazelib_generate_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+/* KERNELS
+*
+* The functions below are the vectorizable inner loops of the library.
+* Each of them exists in a portable version, and on x86 in one or more SIMD versions which produce exactly the same output.
+* The best set is picked once by mazelib_get_kernels.
+*/
+
+/*
+* Expand one column of a compact maze into two columns of a blockwise maze.
+* The cells column contains the cells themselves and the walls to the south of them,
+* while the walls column contains the walls to the east of the cells along with the corners in between.
+* Both output columns are height*2+1 bytes long, and every byte of them is written.
+*/
+typedef void ( *mazelib_expand_column_kernel ) ( const uint8_t* grid, uint32_t height, uint8_t* cells_column, uint8_t* walls_column );
+
+/*
+* Pass count bytes through a table of 16 entries, indexed by the four direction bits of each byte. The other bits are kept.
+* If reverse is nonzero the bytes are written in reverse order, so that output[0] comes from input[count - 1].
+*/
+typedef void ( *mazelib_remap_kernel ) ( const uint8_t* input, uint64_t count, const uint8_t* table, uint8_t reverse, uint8_t* output );
+
+/*
+* Transpose a tile of 16 by 16 bytes and pass it through a table like mazelib_remap_kernel.
+* The 16 bytes at input + i*input_stride become the bytes at output + i, output + i + output_stride and so on. Either stride may be negative.
+*/
+typedef void ( *mazelib_transpose_tile_kernel ) ( const uint8_t* input, ptrdiff_t input_stride, const uint8_t* table, uint8_t* output, ptrdiff_t output_stride );
+
+/* Set count bytes to value. From MAZELIB_STREAMING_THRESHOLD bytes and up, the SIMD variants write around the cache. */
+typedef void ( *mazelib_fill_kernel ) ( uint8_t* output, uint8_t value, uint64_t count );
+
+typedef struct mazelib_kernels mazelib_kernels;
+struct mazelib_kernels
 {
-    uint64_t result, temp, i;
-    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
-    const uint8_t cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
-    uint8_t* cells;
-    uint8_t* grid;
-    uint64_t cells_size = 1;
-    uint8_t directions[4];
+    mazelib_expand_column_kernel expand_column;
+    mazelib_remap_kernel remap;
+    mazelib_transpose_tile_kernel transpose_tile;
+    mazelib_fill_kernel fill;
+};
 
-    if ( output == NULL )
+static void mazelib_expand_column_tail ( const uint8_t* grid, uint32_t y, uint32_t height, uint8_t* cells_column, uint8_t* walls_column )
+{
+    cells_column += ( uint64_t ) y * 2 + 1;
+    walls_column += ( uint64_t ) y * 2 + 1;
+    for ( ; y < height; ++y )
     {
-        return 0;
+        cells_column[0] = 0;
+        cells_column[1] = ( uint8_t ) ( ( grid[y] & mazelib_south ) == 0 );
+        walls_column[0] = ( uint8_t ) ( ( grid[y] & mazelib_east ) == 0 );
+        walls_column[1] = 1;
+        cells_column += 2;
+        walls_column += 2;
     }
-    if ( output_size < required_size )
-    {
+}
+
+static void mazelib_expand_column_generic ( const uint8_t* grid, uint32_t height, uint8_t* cells_column, uint8_t* walls_column )
+{
+    cells_column[0] = 1;
+    walls_column[0] = 1;
+    mazelib_expand_column_tail ( grid, 0, height, cells_column, walls_column );
+}
+
+static void mazelib_remap_generic ( const uint8_t* input, uint64_t count, const uint8_t* table, uint8_t reverse, uint8_t* output )
+{
+    uint64_t i;
+    if ( reverse )
+    {
+        input += count;
+        for ( i = 0; i < count; ++i )
+        {
+            const uint8_t value = *--input;
+            output[i] = ( uint8_t ) ( table[value & 15] | ( value & 0xf0 ) );
+        }
+    }
+    else
+    {
+        for ( i = 0; i < count; ++i )
+        {
+            output[i] = ( uint8_t ) ( table[input[i] & 15] | ( input[i] & 0xf0 ) );
+        }
+    }
+}
+
+static void mazelib_transpose_tile_generic ( const uint8_t* input, ptrdiff_t input_stride, const uint8_t* table, uint8_t* output, ptrdiff_t output_stride )
+{
+    ptrdiff_t row, column;
+    for ( column = 0; column < 16; ++column )
+    {
+        for ( row = 0; row < 16; ++row )
+        {
+            const uint8_t value = input[row * input_stride + column];
+            output[column * output_stride + row] = ( uint8_t ) ( table[value & 15] | ( value & 0xf0 ) );
+        }
+    }
+}
+
+static void mazelib_fill_generic ( uint8_t* output, uint8_t value, uint64_t count )
+{
+    memset ( output, value, ( size_t ) count );
+}
+
+static const mazelib_kernels mazelib_generic_kernels =
+{
+    mazelib_expand_column_generic,
+    mazelib_remap_generic,
+    mazelib_transpose_tile_generic,
+    mazelib_fill_generic
+};
+
+#ifdef MAZELIB_X86_DISPATCH
+
+MAZELIB_TARGET ( "sse2" ) static void mazelib_expand_column_sse2 ( const uint8_t* grid, uint32_t height, uint8_t* cells_column, uint8_t* walls_column )
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i one = _mm_set1_epi8 ( 1 );
+    const __m128i south = _mm_set1_epi8 ( mazelib_south );
+    const __m128i east = _mm_set1_epi8 ( mazelib_east );
+    uint8_t* cells = cells_column + 1;
+    uint8_t* walls = walls_column + 1;
+    uint32_t y;
+
+    cells_column[0] = 1;
+    walls_column[0] = 1;
+    for ( y = 0; height - y >= 16; y += 16, cells += 32, walls += 32 )
+    {
+        const __m128i g = _mm_loadu_si128 ( ( const __m128i* ) ( grid + y ) );
+        const __m128i s = _mm_and_si128 ( _mm_cmpeq_epi8 ( _mm_and_si128 ( g, south ), zero ), one );
+        const __m128i e = _mm_and_si128 ( _mm_cmpeq_epi8 ( _mm_and_si128 ( g, east ), zero ), one );
+        _mm_storeu_si128 ( ( __m128i* ) cells, _mm_unpacklo_epi8 ( zero, s ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( cells + 16 ), _mm_unpackhi_epi8 ( zero, s ) );
+        _mm_storeu_si128 ( ( __m128i* ) walls, _mm_unpacklo_epi8 ( e, one ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( walls + 16 ), _mm_unpackhi_epi8 ( e, one ) );
+    }
+    mazelib_expand_column_tail ( grid, y, height, cells_column, walls_column );
+}
+
+MAZELIB_TARGET ( "avx2" ) static void mazelib_expand_column_avx2 ( const uint8_t* grid, uint32_t height, uint8_t* cells_column, uint8_t* walls_column )
+{
+    const __m256i zero = _mm256_setzero_si256 ();
+    const __m256i one = _mm256_set1_epi8 ( 1 );
+    const __m256i south = _mm256_set1_epi8 ( mazelib_south );
+    const __m256i east = _mm256_set1_epi8 ( mazelib_east );
+    uint8_t* cells = cells_column + 1;
+    uint8_t* walls = walls_column + 1;
+    uint32_t y;
+
+    cells_column[0] = 1;
+    walls_column[0] = 1;
+    for ( y = 0; height - y >= 32; y += 32, cells += 64, walls += 64 )
+    {
+        const __m256i g = _mm256_loadu_si256 ( ( const __m256i* ) ( grid + y ) );
+        const __m256i s = _mm256_and_si256 ( _mm256_cmpeq_epi8 ( _mm256_and_si256 ( g, south ), zero ), one );
+        const __m256i e = _mm256_and_si256 ( _mm256_cmpeq_epi8 ( _mm256_and_si256 ( g, east ), zero ), one );
+
+        /* The unpack instructions work within 128 bit lanes, so the halves have to be put back in order afterwards. */
+        const __m256i cells_low = _mm256_unpacklo_epi8 ( zero, s );
+        const __m256i cells_high = _mm256_unpackhi_epi8 ( zero, s );
+        const __m256i walls_low = _mm256_unpacklo_epi8 ( e, one );
+        const __m256i walls_high = _mm256_unpackhi_epi8 ( e, one );
+        _mm256_storeu_si256 ( ( __m256i* ) cells, _mm256_permute2x128_si256 ( cells_low, cells_high, 0x20 ) );
+        _mm256_storeu_si256 ( ( __m256i* ) ( cells + 32 ), _mm256_permute2x128_si256 ( cells_low, cells_high, 0x31 ) );
+        _mm256_storeu_si256 ( ( __m256i* ) walls, _mm256_permute2x128_si256 ( walls_low, walls_high, 0x20 ) );
+        _mm256_storeu_si256 ( ( __m256i* ) ( walls + 32 ), _mm256_permute2x128_si256 ( walls_low, walls_high, 0x31 ) );
+    }
+    mazelib_expand_column_tail ( grid, y, height, cells_column, walls_column );
+}
+
+MAZELIB_TARGET ( "avx2,avx512f,avx512bw" ) static void mazelib_expand_column_avx512 ( const uint8_t* grid, uint32_t height, uint8_t* cells_column, uint8_t* walls_column )
+{
+    const __m512i one = _mm512_set1_epi8 ( 1 );
+    const __m512i south = _mm512_set1_epi8 ( mazelib_south );
+    const __m512i east = _mm512_set1_epi8 ( mazelib_east );
+    const __m512i corner = _mm512_set1_epi16 ( 0x0100 );
+    uint8_t* cells = cells_column + 1;
+    uint8_t* walls = walls_column + 1;
+    uint32_t y;
+
+    cells_column[0] = 1;
+    walls_column[0] = 1;
+    for ( y = 0; height - y >= 64; y += 64, cells += 128, walls += 128 )
+    {
+        const __m512i g = _mm512_loadu_si512 ( ( const void* ) ( grid + y ) );
+        const __m512i s = _mm512_maskz_mov_epi8 ( _mm512_testn_epi8_mask ( g, south ), one );
+        const __m512i e = _mm512_maskz_mov_epi8 ( _mm512_testn_epi8_mask ( g, east ), one );
+
+        /* Zero extending each byte to 16 bits interleaves it with a zero, which is then shifted or or'ed into place. */
+        _mm512_storeu_si512 ( ( void* ) cells, _mm512_slli_epi16 ( _mm512_cvtepu8_epi16 ( _mm512_castsi512_si256 ( s ) ), 8 ) );
+        _mm512_storeu_si512 ( ( void* ) ( cells + 64 ), _mm512_slli_epi16 ( _mm512_cvtepu8_epi16 ( _mm512_extracti64x4_epi64 ( s, 1 ) ), 8 ) );
+        _mm512_storeu_si512 ( ( void* ) walls, _mm512_or_si512 ( _mm512_cvtepu8_epi16 ( _mm512_castsi512_si256 ( e ) ), corner ) );
+        _mm512_storeu_si512 ( ( void* ) ( walls + 64 ), _mm512_or_si512 ( _mm512_cvtepu8_epi16 ( _mm512_extracti64x4_epi64 ( e, 1 ) ), corner ) );
+    }
+    mazelib_expand_column_tail ( grid, y, height, cells_column, walls_column );
+}
+
+/* The order in which mazelib_transpose_registers_sse2 leaves the columns. */
+static const uint8_t mazelib_transposed_column_order[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+
+/*
+* Load 16 rows of 16 bytes and turn them into 16 columns with four rounds of interleaving, at 8, 16, 32 and 64 bits.
+* Each round pairs up neighboring registers, which leaves the columns in bit reversed order (see mazelib_transposed_column_order).
+*/
+MAZELIB_TARGET ( "sse2" ) static void mazelib_transpose_registers_sse2 ( const uint8_t* input, ptrdiff_t input_stride, __m128i a[16] )
+{
+    __m128i b[16];
+    ptrdiff_t i;
+
+    for ( i = 0; i < 16; ++i )
+    {
+        a[i] = _mm_loadu_si128 ( ( const __m128i* ) ( input + i * input_stride ) );
+    }
+    for ( i = 0; i < 8; ++i )
+    {
+        b[i] = _mm_unpacklo_epi8 ( a[i * 2], a[i * 2 + 1] );
+        b[i + 8] = _mm_unpackhi_epi8 ( a[i * 2], a[i * 2 + 1] );
+    }
+    for ( i = 0; i < 8; ++i )
+    {
+        a[i] = _mm_unpacklo_epi16 ( b[i * 2], b[i * 2 + 1] );
+        a[i + 8] = _mm_unpackhi_epi16 ( b[i * 2], b[i * 2 + 1] );
+    }
+    for ( i = 0; i < 8; ++i )
+    {
+        b[i] = _mm_unpacklo_epi32 ( a[i * 2], a[i * 2 + 1] );
+        b[i + 8] = _mm_unpackhi_epi32 ( a[i * 2], a[i * 2 + 1] );
+    }
+    for ( i = 0; i < 8; ++i )
+    {
+        a[i] = _mm_unpacklo_epi64 ( b[i * 2], b[i * 2 + 1] );
+        a[i + 8] = _mm_unpackhi_epi64 ( b[i * 2], b[i * 2 + 1] );
+    }
+}
+
+/* SSE2 has no byte shuffle, so the table is applied to each column after it has been stored, while it is still in the cache. */
+MAZELIB_TARGET ( "sse2" ) static void mazelib_transpose_tile_sse2 ( const uint8_t* input, ptrdiff_t input_stride, const uint8_t* table, uint8_t* output, ptrdiff_t output_stride )
+{
+    __m128i a[16];
+    ptrdiff_t i;
+
+    mazelib_transpose_registers_sse2 ( input, input_stride, a );
+    for ( i = 0; i < 16; ++i )
+    {
+        uint8_t* column = output + mazelib_transposed_column_order[i] * output_stride;
+        _mm_storeu_si128 ( ( __m128i* ) column, a[i] );
+        mazelib_remap_generic ( column, 16, table, 0, column );
+    }
+}
+
+/* The table fits in one register, so each lookup is a single byte shuffle. */
+MAZELIB_TARGET ( "avx2" ) static void mazelib_transpose_tile_avx2 ( const uint8_t* input, ptrdiff_t input_stride, const uint8_t* table, uint8_t* output, ptrdiff_t output_stride )
+{
+    const __m128i lookup = _mm_loadu_si128 ( ( const __m128i* ) table );
+    const __m128i low_bits = _mm_set1_epi8 ( 15 );
+    __m128i a[16];
+    ptrdiff_t i;
+
+    mazelib_transpose_registers_sse2 ( input, input_stride, a );
+    for ( i = 0; i < 16; ++i )
+    {
+        const __m128i column = _mm_or_si128 ( _mm_shuffle_epi8 ( lookup, _mm_and_si128 ( a[i], low_bits ) ), _mm_andnot_si128 ( low_bits, a[i] ) );
+        _mm_storeu_si128 ( ( __m128i* ) ( output + mazelib_transposed_column_order[i] * output_stride ), column );
+    }
+}
+
+MAZELIB_TARGET ( "avx2" ) static void mazelib_remap_avx2 ( const uint8_t* input, uint64_t count, const uint8_t* table, uint8_t reverse, uint8_t* output )
+{
+    const __m256i lookup = _mm256_broadcastsi128_si256 ( _mm_loadu_si128 ( ( const __m128i* ) table ) );
+    const __m256i low_bits = _mm256_set1_epi8 ( 15 );
+    const __m256i reverse_lane = _mm256_setr_epi8 ( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 );
+    uint64_t i;
+
+    for ( i = 0; count - i >= 32; i += 32 )
+    {
+        __m256i g;
+        if ( reverse )
+        {
+
+            /* Reverse the bytes within each 128 bit lane, then swap the lanes. */
+            g = _mm256_loadu_si256 ( ( const __m256i* ) ( input + count - i - 32 ) );
+            g = _mm256_permute4x64_epi64 ( _mm256_shuffle_epi8 ( g, reverse_lane ), 0x4e );
+        }
+        else
+        {
+            g = _mm256_loadu_si256 ( ( const __m256i* ) ( input + i ) );
+        }
+        g = _mm256_or_si256 ( _mm256_shuffle_epi8 ( lookup, _mm256_and_si256 ( g, low_bits ) ), _mm256_andnot_si256 ( low_bits, g ) );
+        _mm256_storeu_si256 ( ( __m256i* ) ( output + i ), g );
+    }
+    mazelib_remap_generic ( reverse ? input : input + i, count - i, table, reverse, output + i );
+}
+
+/*
+* Non-temporal stores need aligned addresses, so the ends are left to memset. They are also weakly ordered,
+* so the fence makes them visible before anything the caller writes next, for example from another thread.
+*/
+MAZELIB_TARGET ( "sse2" ) static void mazelib_fill_sse2 ( uint8_t* output, uint8_t value, uint64_t count )
+{
+    const __m128i v = _mm_set1_epi8 ( ( char ) value );
+    uint64_t head, i;
+
+    if ( count < MAZELIB_STREAMING_THRESHOLD )
+    {
+        memset ( output, value, ( size_t ) count );
+        return;
+    }
+    head = ( 16 - ( ( size_t ) output & 15 ) ) & 15;
+    if ( head > count )
+    {
+        head = count;
+    }
+    memset ( output, value, ( size_t ) head );
+    for ( i = head; count - i >= 64; i += 64 )
+    {
+        _mm_stream_si128 ( ( __m128i* ) ( output + i ), v );
+        _mm_stream_si128 ( ( __m128i* ) ( output + i + 16 ), v );
+        _mm_stream_si128 ( ( __m128i* ) ( output + i + 32 ), v );
+        _mm_stream_si128 ( ( __m128i* ) ( output + i + 48 ), v );
+    }
+    _mm_sfence ();
+    memset ( output + i, value, ( size_t ) ( count - i ) );
+}
+
+MAZELIB_TARGET ( "avx2" ) static void mazelib_fill_avx2 ( uint8_t* output, uint8_t value, uint64_t count )
+{
+    const __m256i v = _mm256_set1_epi8 ( ( char ) value );
+    uint64_t head, i;
+
+    if ( count < MAZELIB_STREAMING_THRESHOLD )
+    {
+        memset ( output, value, ( size_t ) count );
+        return;
+    }
+    head = ( 32 - ( ( size_t ) output & 31 ) ) & 31;
+    if ( head > count )
+    {
+        head = count;
+    }
+    memset ( output, value, ( size_t ) head );
+    for ( i = head; count - i >= 128; i += 128 )
+    {
+        _mm256_stream_si256 ( ( __m256i* ) ( output + i ), v );
+        _mm256_stream_si256 ( ( __m256i* ) ( output + i + 32 ), v );
+        _mm256_stream_si256 ( ( __m256i* ) ( output + i + 64 ), v );
+        _mm256_stream_si256 ( ( __m256i* ) ( output + i + 96 ), v );
+    }
+    _mm_sfence ();
+    memset ( output + i, value, ( size_t ) ( count - i ) );
+}
+
+static const mazelib_kernels mazelib_sse2_kernels =
+{
+    mazelib_expand_column_sse2,
+    mazelib_remap_generic,
+    mazelib_transpose_tile_sse2,
+    mazelib_fill_sse2
+};
+
+static const mazelib_kernels mazelib_avx2_kernels =
+{
+    mazelib_expand_column_avx2,
+    mazelib_remap_avx2,
+    mazelib_transpose_tile_avx2,
+    mazelib_fill_avx2
+};
+
+static const mazelib_kernels mazelib_avx512_kernels =
+{
+    mazelib_expand_column_avx512,
+    mazelib_remap_avx2,
+    mazelib_transpose_tile_avx2,
+    mazelib_fill_avx2
+};
+
+static void mazelib_cpuid ( uint32_t leaf, uint32_t subleaf, uint32_t registers[4] )
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex ( info, ( int ) leaf, ( int ) subleaf );
+    registers[0] = ( uint32_t ) info[0];
+    registers[1] = ( uint32_t ) info[1];
+    registers[2] = ( uint32_t ) info[2];
+    registers[3] = ( uint32_t ) info[3];
+#else
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    if ( __get_cpuid_max ( leaf & 0x80000000u, NULL ) >= leaf )
+    {
+        __cpuid_count ( leaf, subleaf, a, b, c, d );
+    }
+    registers[0] = a;
+    registers[1] = b;
+    registers[2] = c;
+    registers[3] = d;
+#endif
+}
+
+/* Read the XCR0 register, which tells us which register files the operating system saves on context switches. */
+static uint64_t mazelib_xgetbv ( void )
+{
+#ifdef _MSC_VER
+    return ( uint64_t ) _xgetbv ( 0 );
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__ ( "xgetbv" : "=a" ( eax ), "=d" ( edx ) : "c" ( 0 ) );
+    return ( ( uint64_t ) edx << 32 ) | eax;
+#endif
+}
+
+static const mazelib_kernels* mazelib_detect_kernels ( void )
+{
+    uint32_t leaf1[4], leaf7[4];
+    uint64_t xcr0 = 0;
+
+    mazelib_cpuid ( 1, 0, leaf1 );
+    if ( ( leaf1[3] & ( 1u << 26 ) ) == 0 )
+    {
+        return &mazelib_generic_kernels;    /* No SSE2. */
+    }
+    if ( ( leaf1[2] & ( 1u << 27 ) ) == 0 )
+    {
+        return &mazelib_sse2_kernels;    /* No OSXSAVE, so no AVX state either. */
+    }
+    xcr0 = mazelib_xgetbv ();
+    if ( ( xcr0 & 0x6 ) != 0x6 )
+    {
+        return &mazelib_sse2_kernels;
+    }
+    mazelib_cpuid ( 7, 0, leaf7 );
+    if ( ( leaf7[1] & ( 1u << 5 ) ) == 0 )
+    {
+        return &mazelib_sse2_kernels;    /* No AVX2. */
+    }
+    if ( ( xcr0 & 0xe6 ) == 0xe6 && ( leaf7[1] & ( 1u << 16 ) ) && ( leaf7[1] & ( 1u << 30 ) ) )
+    {
+        return &mazelib_avx512_kernels;    /* AVX-512F and AVX-512BW, with the opmask and upper register state enabled. */
+    }
+    return &mazelib_avx2_kernels;
+}
+
+#endif /* MAZELIB_X86_DISPATCH */
+
+/*
+* Return the kernel table for this CPU.
+* The table is detected on first use and cached in a single pointer.
+* If several threads race on the first call they all store the same value, so no locking is needed.
+*/
+static const mazelib_kernels* mazelib_get_kernels ( void )
+{
+#ifdef MAZELIB_X86_DISPATCH
+    static const mazelib_kernels* volatile active_kernels = NULL;
+    const mazelib_kernels* kernels = active_kernels;
+    if ( kernels == NULL )
+    {
+        kernels = mazelib_detect_kernels ();
+        active_kernels = kernels;
+    }
+    return kernels;
+#else
+    return &mazelib_generic_kernels;
+#endif
+}
+
+#define mazelib_path_bit(path, index) ( ( path[( index ) >> 3] >> ( ( index ) & 7 ) ) & 1 )
+
+/*
+* Draw the marked cells of one compact column into the pair of blockwise columns the kernel has just written.
+* Bytes of the path with no marked cells are skipped whole. Within the others every cell is drawn without branching on the path,
+* which works because the kernel has left each cell block and each open gap at 0. Only the gaps to the east and south are drawn here; the others belong to the neighbors.
+*/
+static void mazelib_draw_path_column ( uint32_t width, uint32_t height, const uint8_t* grid, const uint8_t* path, uint32_t x, uint8_t* cells_column, uint8_t* walls_column )
+{
+    const uint64_t first = ( uint64_t ) x * height;
+    const uint64_t end = first + height;
+    const uint8_t has_east = ( uint8_t ) ( x + 1 < width );
+    uint64_t i = first;
+
+    while ( i < end )
+    {
+        uint64_t stop = i + 1;
+        if ( ( i & 7 ) == 0 && end - i >= 8 )
+        {
+            if ( path[i >> 3] == 0 )
+            {
+                i += 8;
+                continue;
+            }
+            stop = i + 8;
+        }
+        for ( ; i < stop; ++i )
+        {
+            const uint64_t y = i - first;
+            const uint8_t marked = ( uint8_t ) mazelib_path_bit ( path, i );
+            cells_column[y * 2 + 1] = ( uint8_t ) ( marked << 1 );
+            if ( i + 1 < end )
+            {
+                cells_column[y * 2 + 2] |= ( uint8_t ) ( ( marked & ( grid[i] >> 3 ) & mazelib_path_bit ( path, i + 1 ) ) << 1 );
+            }
+            if ( has_east )
+            {
+                walls_column[y * 2 + 1] |= ( uint8_t ) ( ( marked & ( grid[i] >> 1 ) & mazelib_path_bit ( path, i + height ) ) << 1 );
+            }
+        }
+    }
+}
+
+/*
+* Produce the pair of blockwise columns that belongs to each of the given compact columns. output points to the start of the whole blockwise maze.
+* If path is not NULL, it is drawn into each pair of columns right after they are produced.
+*/
+static void mazelib_expand_columns ( uint32_t width, uint32_t height, const uint8_t* grid, const uint8_t* path, uint32_t first_column, uint32_t column_count, uint8_t* output )
+{
+    const mazelib_kernels* kernels = mazelib_get_kernels ();
+    const uint64_t new_height = ( uint64_t ) height * 2 + 1;
+    const uint8_t* column = grid + ( uint64_t ) first_column * height;
+    uint32_t x;
+
+    output += ( ( uint64_t ) first_column * 2 + 1 ) * new_height;
+    for ( x = first_column; x < first_column + column_count; ++x )
+    {
+        kernels->expand_column ( column, height, output, output + new_height );
+        if ( path )
+        {
+            mazelib_draw_path_column ( width, height, grid, path, x, output, output + new_height );
+        }
+        column += height;
+        output += new_height * 2;
+    }
+}
+
+/* Convert a compact grid to the blockwise format and return the number of bytes written. The grid and the output must not overlap. */
+static uint64_t mazelib_expand_to_blockwise ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* output )
+{
+    const uint64_t new_height = ( uint64_t ) height * 2 + 1;
+
+    MAZELIB_TRACE_BEGIN ( "blockwise" );
+
+    /* The western border is a solid wall, and every following pair of columns is produced by the kernel. */
+    memset ( output, 1, ( size_t ) new_height );
+    mazelib_expand_columns ( width, height, grid, NULL, 0, width, output );
+
+    MAZELIB_TRACE_END ( "blockwise" );
+    return ( ( uint64_t ) width * 2 + 1 ) * new_height;
+}
+
+uint64_t mazelib_convert_to_blockwise ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* output, uint64_t output_size )
+{
+    if ( grid == NULL || output == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 )
+    {
+        return 0;
+    }
+    if ( output_size < ( ( uint64_t ) width * 2 + 1 ) * ( ( uint64_t ) height * 2 + 1 ) )
+    {
+        return 0;
+    }
+    return mazelib_expand_to_blockwise ( width, height, grid, output );
+}
+
+uint64_t mazelib_convert_columns_to_blockwise_with_path ( uint32_t width, uint32_t height, const uint8_t* grid, const uint8_t* path, uint32_t first_column, uint32_t column_count, uint8_t* output, uint64_t output_size )
+{
+    const uint64_t size = ( ( uint64_t ) width * 2 + 1 ) * ( ( uint64_t ) height * 2 + 1 );
+
+    if ( grid == NULL || output == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 )
+    {
+        return 0;
+    }
+    if ( first_column > width || column_count > width - first_column )
+    {
+        return 0;
+    }
+    if ( output_size < size )
+    {
+        return 0;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "blockwise" );
+    if ( first_column == 0 )
+    {
+        memset ( output, 1, ( size_t ) ( ( uint64_t ) height * 2 + 1 ) );
+    }
+    mazelib_expand_columns ( width, height, grid, path, first_column, column_count, output );
+    MAZELIB_TRACE_END ( "blockwise" );
+    return size;
+}
+
+uint64_t mazelib_convert_columns_to_blockwise ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t first_column, uint32_t column_count, uint8_t* output, uint64_t output_size )
+{
+    return mazelib_convert_columns_to_blockwise_with_path ( width, height, grid, NULL, first_column, column_count, output, output_size );
+}
+
+uint64_t mazelib_convert_to_blockwise_with_path ( uint32_t width, uint32_t height, const uint8_t* grid, const uint8_t* path, uint8_t* output, uint64_t output_size )
+{
+    return mazelib_convert_columns_to_blockwise_with_path ( width, height, grid, path, 0, width, output, output_size );
+}
+
+/*
+* Fill in a memory report for a maze whose list of cells grew to high_water entries of cell_bytes each,
+* and where moved_bytes were moved to remove cells from the middle of the list.
+*/
+static void mazelib_fill_memory_report ( uint32_t width, uint32_t height, uint8_t blockwise, uint8_t cell_bytes, uint64_t high_water, uint64_t moved_bytes, mazelib_memory_report* report )
+{
+    const uint64_t area = ( uint64_t ) width * height;
+    const uint64_t list_bytes = high_water * cell_bytes;
+
+    report->scratch_bytes = area * cell_bytes;
+    report->frontier_high_water = high_water;
+
+    /*
+    * The traffic is the clearing of the grid, the first cell, one list entry read and four neighbors examined in each of the 2*area-1 steps,
+    * a read and write of two grid cells and a new list entry for each of the area-1 passages, and reading and writing every byte that is moved.
+    */
+    report->bytes_touched = area + cell_bytes + ( area * 2 - 1 ) * ( cell_bytes + 4 ) + ( area - 1 ) * ( cell_bytes + 4 ) + moved_bytes * 2;
+
+    if ( blockwise )
+    {
+        report->output_bytes = ( ( uint64_t ) width * 2 + 1 ) * ( ( uint64_t ) height * 2 + 1 );
+
+        /* The list and the output share the beginning of the buffer, and the grid is at the end where nothing else goes. */
+        report->peak_resident_bytes = ( list_bytes > report->output_bytes ? list_bytes : report->output_bytes ) + area;
+
+        /* The conversion reads the grid and writes the output. */
+        report->bytes_touched += area + report->output_bytes;
+    }
+    else
+    {
+        report->output_bytes = area;
+        report->peak_resident_bytes = area + list_bytes;
+    }
+    report->buffer_bytes = report->output_bytes + report->scratch_bytes;
+}
+
+uint64_t mazelib_get_memory_report ( uint32_t width, uint32_t height, uint8_t blockwise, uint8_t cell_bytes, mazelib_memory_report* report )
+{
+    uint64_t area;
+
+    if ( report == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 )
+    {
+        return 0;
+    }
+    area = width;
+    area *= height;
+    if ( cell_bytes == 0 )
+    {
+        cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
+    }
+    else if ( cell_bytes != 1 && cell_bytes != 2 && cell_bytes != 4 && cell_bytes != 8 )
+    {
+        return 0;
+    }
+    else if ( cell_bytes < 8 && area - 1 > ( ( uint64_t ) 1 << ( cell_bytes * 8 ) ) - 1 )
+    {
+        return 0;    /* Some cell indices would not fit in an entry. */
+    }
+    mazelib_fill_memory_report ( width, height, blockwise, cell_bytes, area, 0, report );
+    return report->buffer_bytes;
+}
+
+/* Append value to a carve log as a variable length integer. Returns 0 if it does not fit. */
+static uint8_t mazelib_put_varint ( mazelib_carve_log* log, uint64_t value )
+{
+    for ( ;; )
+    {
+        if ( log->size >= log->capacity )
+        {
+            return 0;
+        }
+        if ( value < 0x80 )
+        {
+            log->data[log->size++] = ( uint8_t ) value;
+            return 1;
+        }
+        log->data[log->size++] = ( uint8_t ) ( ( value & 0x7f ) | 0x80 );
+        value >>= 7;
+    }
+}
+
+static uint64_t mazelib_get_varint ( const uint8_t* data, uint64_t* offset )
+{
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+
+    do
+    {
+        byte = data[( *offset )++];
+        value |= ( uint64_t ) ( byte & 0x7f ) << shift;
+        shift += 7;
+    }
+    while ( byte & 0x80 );
+    return value;
+}
+
+/* Record a passage from one cell to a new one, in the format described with mazelib_carve_log. Returns 0 if the log is full. */
+static uint8_t mazelib_record_carve ( mazelib_carve_log* log, uint64_t from, uint8_t direction, uint64_t to )
+{
+    const uint64_t difference = from - log->last_cell;
+    const uint64_t distance = ( difference << 1 ) ^ ( 0 - ( difference >> 63 ) );
+    const uint8_t direction_index = ( uint8_t ) ( direction < mazelib_north ? direction >> 1 : 2 + ( direction >> 3 ) );
+
+    if ( log->keyframe_interval && log->events % log->keyframe_interval == 0 && log->keyframe_count < log->keyframe_capacity )
+    {
+        log->keyframes[log->keyframe_count * 2] = log->size;
+        log->keyframes[log->keyframe_count * 2 + 1] = log->last_cell;
+        ++log->keyframe_count;
+    }
+    if ( log->size >= log->capacity )
+    {
+        return 0;
+    }
+    if ( distance < 63 )
+    {
+        log->data[log->size++] = ( uint8_t ) ( direction_index | ( distance << 2 ) );
+    }
+    else
+    {
+        log->data[log->size++] = ( uint8_t ) ( direction_index | ( 63 << 2 ) );
+        if ( !mazelib_put_varint ( log, distance - 63 ) )
+        {
+            return 0;
+        }
+    }
+    if ( log->visit_order )
+    {
+        log->visit_order[to] = ( uint32_t ) ( log->events + 1 );
+    }
+    log->last_cell = to;
+    ++log->events;
+    return 1;
+}
+
+/* Find the cell next to cell x, y in the direction with the given index (west, east, north, south). Returns 0 if that would leave the maze. */
+static uint8_t mazelib_get_neighbor ( uint32_t width, uint32_t height, uint64_t cell, uint32_t x, uint32_t y, uint8_t direction_index, uint64_t* neighbor )
+{
+    switch ( direction_index )
+    {
+        case 0:
+            *neighbor = cell - height;
+            return x > 0;
+        case 1:
+            *neighbor = cell + height;
+            return x < width - 1;
+        case 2:
+            *neighbor = cell - 1;
+            return y > 0;
+        default:
+            *neighbor = cell + 1;
+            return y < height - 1;
+    };
+}
+
+/* Cells which have been reached while completing a maze. Unlike in plain generation, cells with passages may not have been reached yet. */
+#define mazelib_completion_visited 0x10
+
+/*
+* Add every cell joined to start by carved passages to the end of the list, using the list itself as the queue of a breadth first search.
+* A group of n cells without loops has exactly n - 1 passages, each seen from both ends. Returns 0 if there are more.
+*/
+static uint8_t mazelib_add_carved_group ( uint32_t width, uint32_t height, uint8_t* grid, uint8_t* cells, uint8_t cell_bytes, uint64_t* cells_size, uint64_t start )
+{
+    uint64_t head = *cells_size;
+    uint64_t tail = head;
+    uint64_t passage_ends = 0;
+
+    grid[start] |= mazelib_completion_visited;
+    mazelib_assign_cell ( cells, cell_bytes, tail++, start );
+    while ( head < tail )
+    {
+        const uint64_t cell = mazelib_read_cell ( cells, cell_bytes, head++ );
+        const uint32_t x = ( uint32_t ) ( cell / height );
+        const uint32_t y = ( uint32_t ) ( cell % height );
+        uint8_t d;
+
+        for ( d = 0; d < 4; ++d )
+        {
+            uint64_t neighbor;
+            if ( ! ( grid[cell] & ( 1 << d ) ) )
+            {
+                continue;
+            }
+            ++passage_ends;
+            mazelib_get_neighbor ( width, height, cell, x, y, d, &neighbor );
+            if ( ! ( grid[neighbor] & mazelib_completion_visited ) )
+            {
+                grid[neighbor] |= mazelib_completion_visited;
+                mazelib_assign_cell ( cells, cell_bytes, tail++, neighbor );
+            }
+        }
+    }
+    if ( passage_ends != ( tail - *cells_size - 1 ) * 2 )
+    {
+        return 0;
+    }
+    *cells_size = tail;
+    return 1;
+}
+
+/*
+* The growing tree algorithm itself. The grid must be 0 for every unvisited cell, and the list must hold cells_size cells to start from.
+* To complete a maze, join_carved_groups instead treats the cells without mazelib_completion_visited as unvisited,
+* and adds the whole carved group of each new cell to the list. No passage is then carved through a wall set in locked_walls, which may be NULL.
+* Returns 1 when the list is empty, or 0 if the callback returned an index outside the list or a carved group has a loop.
+*/
+static uint8_t mazelib_grow_tree ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t* grid, uint8_t* cells, uint8_t cell_bytes, uint64_t cells_size, uint64_t* high_water, uint64_t* moved_bytes, mazelib_carve_log* log, const uint8_t* locked_walls, uint8_t join_carved_groups )
+{
+    const uint8_t visited = join_carved_groups ? mazelib_completion_visited : 0xff;
+    uint64_t temp, i;
+    uint8_t directions[4];
+
+    directions[0] = mazelib_west;
+    directions[1] = mazelib_east;
+    directions[2] = mazelib_north;
+    directions[3] = mazelib_south;
+
+    while ( cells_size )
+    {
+        uint32_t x, y, new_x, new_y;
+        uint64_t new_cell_index, current_cell;
+        uint64_t cell_index = 0;
+        uint8_t found_new_neighbor = 0;
+        uint8_t opposite_direction = 0;
+
+        MAZELIB_STATS_ADD ( prng, steps, 1 );
+
+        if ( cells_size > 1 )
+        {
+            MAZELIB_STATS_ADD ( prng, callback_calls, 1 );
+            cell_index = cell_selection_callback ( cells_size, prng, user );
+            if ( cell_index >= cells_size )
+            {
+                return 0;    /* The callback returned a value outside the allowed range, so we abort. */
+            }
+        }
+
+        switch ( cell_bytes )
+        {
+            case 1:
+            {
+                current_cell = cells[cell_index];
+            }
+            break;
+            case 2:
+            {
+                uint16_t* cell_ptr = ( uint16_t* ) cells;
+                current_cell = cell_ptr[cell_index];
+            }
+            break;
+            case 4:
+            {
+                uint32_t* cell_ptr = ( uint32_t* ) cells;
+                current_cell = cell_ptr[cell_index];
+            }
+            break;
+            default:
+            {
+                uint64_t* cell_ptr = ( uint64_t* ) cells;
+                current_cell = cell_ptr[cell_index];
+            }
+            break;
+        };
+
+        x = ( uint32_t ) ( current_cell / height );
+        y = ( uint32_t ) ( current_cell % height );
+
+        /* Shuffle the directions. */
+        for ( i = 3; i; --i )
+        {
+            uint8_t swap_index = ( uint8_t ) mazelib_prng_next_in_range ( prng, i + 1 );
+            temp = directions[i];
+            directions[i] = directions[swap_index];
+            directions[swap_index] = temp;
+        }
+
+        for ( i = 0; i < 4; ++i )
+        {
+            switch ( directions[i] )
+            {
+                case mazelib_west:
+                    if ( x == 0 )
+                    {
+                        continue;
+                    }
+                    new_x = x - 1;
+                    new_y = y;
+                    opposite_direction = mazelib_east;
+                    break;
+                case mazelib_east:
+                    if ( x == width - 1 )
+                    {
+                        continue;
+                    }
+                    new_x = x + 1;
+                    new_y = y;
+                    opposite_direction = mazelib_west;
+                    break;
+                case mazelib_north:
+                    if ( y == 0 )
+                    {
+                        continue;
+                    }
+                    new_x = x;
+                    new_y = y - 1;
+                    opposite_direction = mazelib_south;
+                    break;
+                default: /* South */
+                    if ( y == height - 1 )
+                    {
+                        continue;
+                    }
+                    new_x = x;
+                    new_y = y + 1;
+                    opposite_direction = mazelib_north;
+                    break;
+            };
+            new_cell_index = mazelib_get_cell_index ( new_x, new_y, height );
+            assert ( new_cell_index < ( width * height ) );
+
+            /* If we have already visited the given cell, we don't consider it again. */
+            if ( grid[new_cell_index] & visited )
+            {
+                continue;
+            }
+            if ( locked_walls && ( ( locked_walls[current_cell] & directions[i] ) || ( locked_walls[new_cell_index] & opposite_direction ) ) )
+            {
+                continue;
+            }
+
+            found_new_neighbor = 1;
+
+            if ( join_carved_groups )
+            {
+                /* The whole group of the new cell joins the list before the passage is carved, so that the passage is not mistaken for part of the group. */
+                if ( !mazelib_add_carved_group ( width, height, grid, cells, cell_bytes, &cells_size, new_cell_index ) )
+                {
+                    return 0;
+                }
+                grid[current_cell] |= directions[i];
+                grid[new_cell_index] |= opposite_direction;
+                if ( cells_size > *high_water )
+                {
+                    *high_water = cells_size;
+                }
+                MAZELIB_STATS_MAX ( prng, max_frontier, cells_size );
+                break;
+            }
+
+            /* Carve a two way path between the current and the new cell. */
+            grid[current_cell] |= directions[i];
+            grid[new_cell_index] |= opposite_direction;
+            if ( log && !mazelib_record_carve ( log, current_cell, directions[i], new_cell_index ) )
+            {
+                return 0;    /* The log is full. */
+            }
+
+            /* Add the new cell to our list. */
+            switch ( cell_bytes )
+            {
+                case 1:
+                    cells[cells_size] = ( uint8_t ) new_cell_index;
+                    break;
+                case 2:
+                {
+                    uint16_t* cell_ptr = ( uint16_t* ) cells;
+                    cell_ptr[cells_size] = ( uint16_t ) new_cell_index;
+                }
+                break;
+                case 4:
+                {
+                    uint32_t* cell_ptr = ( uint32_t* ) cells;
+                    cell_ptr[cells_size] = ( uint32_t ) new_cell_index;
+                }
+                break;
+                default:
+                {
+                    uint64_t* cell_ptr = ( uint64_t* ) cells;
+                    cell_ptr[cells_size] = new_cell_index;
+                }
+            };
+
+            ++cells_size;
+            if ( cells_size > *high_water )
+            {
+                *high_water = cells_size;
+            }
+            MAZELIB_STATS_MAX ( prng, max_frontier, cells_size );
+            break;
+        }
+        if ( found_new_neighbor == 0 )
+        {
+
+            /* The current cell has no unvisited neighbors, so we remove it from our list. */
+            MAZELIB_STATS_ADD ( prng, dead_end_removals, 1 );
+            if ( cell_index < cells_size - 1 )
+            {
+                *moved_bytes += ( cells_size - ( cell_index + 1 ) ) * cell_bytes;
+                MAZELIB_STATS_ADD ( prng, memmove_bytes, ( cells_size - ( cell_index + 1 ) ) * cell_bytes );
+                memmove ( ( void* ) &cells[cell_index * cell_bytes], ( void* ) &cells[ ( cell_index + 1 ) *cell_bytes], ( cells_size - ( cell_index + 1 ) ) *cell_bytes );
+            }
+            --cells_size;
+        }
+    }
+
+    return 1;
+}
+
+uint64_t mazelib_generate_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    return mazelib_generate_extended_with_report ( width, height, prng, cell_selection_callback, user, blockwise, output, output_size, NULL );
+}
+
+/* The body of mazelib_generate_extended_with_report and mazelib_generate_recorded_extended. The log is reset and validated by the caller. */
+static uint64_t mazelib_generate_logged ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size, mazelib_memory_report* report, mazelib_carve_log* log )
+{
+    uint64_t result, temp;
+    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
+    const uint8_t cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
+    uint8_t* cells;
+    uint8_t* grid;
+    uint64_t cells_size = 1;
+    uint64_t high_water = 1;
+    uint64_t moved_bytes = 0;
+
+    if ( output == NULL )
+    {
+        return 0;
+    }
+    if ( output_size < required_size )
+    {
+        return 0;
+    }
+    if ( prng == NULL )
+    {
+        return 0;
+    }
+    if ( cell_selection_callback == NULL )
+    {
+        return 0;
+    }
+
+    output_size = required_size;
+
+#ifdef MAZELIB_STATS
+    memset ( &prng->stats, 0, sizeof ( prng->stats ) );
+    prng->stats.max_frontier = 1;
+#endif
+
+    result = width;
+    result *= height;
+
+    if ( blockwise )
+    {
+
+        /* If we are generating a blockwise maze, we put the temporary storage at the beginning so that we can then override it with the final result at the end. */
+        grid = output + output_size;
+        grid -= result;
+        cells = output;
+    }
+    else
+    {
+
+        /* If we are not generating a blockwise maze, we put the grid at the beginning since that will be our final result. */
+        grid = output;
+        cells = output + result;
+    }
+
+    /* Clear the grid initially. */
+    MAZELIB_TRACE_BEGIN ( "clear" );
+    mazelib_get_kernels ()->fill ( grid, 0, result );
+    MAZELIB_TRACE_END ( "clear" );
+
+    MAZELIB_TRACE_BEGIN ( "carve" );
+
+    /*
+    * Start by inserting a random cell.
+    * The row is drawn before the column. The order used to be left to the compiler, and this is the one GCC picked.
+    */
+    temp = mazelib_prng_next_in_range ( prng, height );
+    temp = mazelib_get_cell_index ( ( uint32_t ) mazelib_prng_next_in_range ( prng, width ), ( uint32_t ) temp, height );
+    mazelib_assign_cell ( cells, cell_bytes, 0, temp );
+    if ( log )
+    {
+        log->last_cell = temp;
+        if ( log->visit_order )
+        {
+            log->visit_order[temp] = 0;
+        }
+        if ( !mazelib_put_varint ( log, temp ) )
+        {
+            MAZELIB_TRACE_END ( "carve" );
+            return 0;
+        }
+    }
+
+    if ( !mazelib_grow_tree ( width, height, prng, cell_selection_callback, user, grid, cells, cell_bytes, cells_size, &high_water, &moved_bytes, log, NULL, 0 ) )
+    {
+        MAZELIB_TRACE_END ( "carve" );
+        return 0;
+    }
+
+    MAZELIB_TRACE_END ( "carve" );
+
+    if ( blockwise )
+    {
+        result = mazelib_expand_to_blockwise ( width, height, grid, output );
+    }
+    if ( report )
+    {
+        mazelib_fill_memory_report ( width, height, blockwise, cell_bytes, high_water, moved_bytes, report );
+    }
+
+    return result;
+}
+
+uint64_t mazelib_generate_extended_with_report ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size, mazelib_memory_report* report )
+{
+    return mazelib_generate_logged ( width, height, prng, cell_selection_callback, user, blockwise, output, output_size, report, NULL );
+}
+
+static uint64_t mazelib_high_level_cell_selection_callback ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    int8_t* random_threshold_percent = ( int8_t* ) user;
+    if ( *random_threshold_percent > 0 && ( int8_t ) mazelib_prng_next_in_range ( prng, 101 ) < *random_threshold_percent )
+    {
+        return mazelib_prng_next_in_range ( prng, count );
+    }
+    return count - 1;
+}
+
+uint64_t mazelib_generate ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_generate_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, blockwise, output, output_size );
+}
+
+/* Set while generating a symmetric maze on cells that have been visited but have no passages yet. It is cleared before returning. */
+#define mazelib_symmetry_visited 16
+
+/*
+* The images of a cell under a symmetry, other than the cell itself.
+* Mirroring in x swaps west and east, mirroring in y swaps north and south, and turning around does both.
+*/
+typedef struct mazelib_symmetry_image mazelib_symmetry_image;
+struct mazelib_symmetry_image
+{
+    uint8_t flip_x;
+    uint8_t flip_y;
+};
+
+static uint8_t mazelib_flip_direction ( uint8_t direction, const mazelib_symmetry_image* image )
+{
+    if ( image->flip_x && ( direction & ( mazelib_west | mazelib_east ) ) )
+    {
+        return direction ^ ( mazelib_west | mazelib_east );
+    }
+    if ( image->flip_y && ( direction & ( mazelib_north | mazelib_south ) ) )
+    {
+        return direction ^ ( mazelib_north | mazelib_south );
+    }
+    return direction;
+}
+
+/* Carve a passage from a cell in the given direction, along with all of its images. Both cells must be inside the maze. */
+static void mazelib_carve_symmetric ( uint8_t* grid, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint8_t direction, const mazelib_symmetry_image* images, unsigned int image_count )
+{
+    const uint32_t new_x = direction == mazelib_west ? x - 1 : direction == mazelib_east ? x + 1 : x;
+    const uint32_t new_y = direction == mazelib_north ? y - 1 : direction == mazelib_south ? y + 1 : y;
+    const uint8_t opposite_direction = direction & ( mazelib_west | mazelib_east ) ? direction ^ ( mazelib_west | mazelib_east ) : direction ^ ( mazelib_north | mazelib_south );
+    unsigned int i;
+
+    grid[mazelib_get_cell_index ( x, y, height )] |= direction;
+    grid[mazelib_get_cell_index ( new_x, new_y, height )] |= opposite_direction;
+    for ( i = 0; i < image_count; ++i )
+    {
+        const uint32_t image_x = images[i].flip_x ? width - 1 - x : x;
+        const uint32_t image_y = images[i].flip_y ? height - 1 - y : y;
+        const uint32_t image_new_x = images[i].flip_x ? width - 1 - new_x : new_x;
+        const uint32_t image_new_y = images[i].flip_y ? height - 1 - new_y : new_y;
+        grid[mazelib_get_cell_index ( image_x, image_y, height )] |= mazelib_flip_direction ( direction, &images[i] );
+        grid[mazelib_get_cell_index ( image_new_x, image_new_y, height )] |= mazelib_flip_direction ( opposite_direction, &images[i] );
+    }
+}
+
+uint64_t mazelib_generate_symmetric_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t symmetry, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    uint64_t result, temp, i;
+    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
+    const uint8_t cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
+    const uint8_t odd_width = width & 1;
+    const uint8_t odd_height = height & 1;
+    mazelib_symmetry_image images[3];
+    unsigned int image_count = 0;
+    uint8_t* cells;
+    uint8_t* grid;
+    uint64_t cells_size = 0;
+    uint8_t directions[4];
+
+    if ( output == NULL )
+    {
+        return 0;
+    }
+    if ( output_size < required_size || required_size == 0 )
+    {
+        return 0;
+    }
+    if ( prng == NULL )
+    {
+        return 0;
+    }
+    if ( cell_selection_callback == NULL )
+    {
+        return 0;
+    }
+    switch ( symmetry )
+    {
+        case mazelib_symmetry_mirror_x:
+            images[image_count].flip_x = 1;
+            images[image_count++].flip_y = 0;
+            break;
+        case mazelib_symmetry_mirror_y:
+            images[image_count].flip_x = 0;
+            images[image_count++].flip_y = 1;
+            break;
+        case mazelib_symmetry_mirror_both:
+            images[image_count].flip_x = 1;
+            images[image_count++].flip_y = 0;
+            images[image_count].flip_x = 0;
+            images[image_count++].flip_y = 1;
+
+            /* Mirroring in both directions also turns the maze around. */
+            images[image_count].flip_x = 1;
+            images[image_count++].flip_y = 1;
+            if ( !odd_width && !odd_height )
+            {
+                return 0;
+            }
+            break;
+        case mazelib_symmetry_rotate_180:
+            images[image_count].flip_x = 1;
+            images[image_count++].flip_y = 1;
+            if ( !odd_width && !odd_height )
+            {
+                return 0;
+            }
+            break;
+        default:
+            return 0;
+    }
+
+    output_size = required_size;
+
+#ifdef MAZELIB_STATS
+    memset ( &prng->stats, 0, sizeof ( prng->stats ) );
+#endif
+
+    result = width;
+    result *= height;
+
+    /* The same layout as for mazelib_generate_extended. */
+    if ( blockwise )
+    {
+        grid = output + output_size;
+        grid -= result;
+        cells = output;
+    }
+    else
+    {
+        grid = output;
+        cells = output + result;
+    }
+
+    directions[0] = mazelib_west;
+    directions[1] = mazelib_east;
+    directions[2] = mazelib_north;
+    directions[3] = mazelib_south;
+
+    MAZELIB_TRACE_BEGIN ( "clear" );
+    mazelib_get_kernels ()->fill ( grid, 0, result );
+    MAZELIB_TRACE_END ( "clear" );
+
+    MAZELIB_TRACE_BEGIN ( "carve" );
+
+    /*
+    * Start with the cells and passages that the symmetry leaves in place.
+    * A mirror axis through a column or row of cells becomes a straight passage, and every cell on it goes into the list.
+    * Otherwise the maze is centered on a single cell, or on a single passage across the axis.
+    */
+    if ( symmetry == mazelib_symmetry_rotate_180 )
+    {
+        const uint32_t x = ( width - 1 ) / 2;
+        const uint32_t y = ( height - 1 ) / 2;
+        if ( odd_width && odd_height )
+        {
+            grid[mazelib_get_cell_index ( x, y, height )] = mazelib_symmetry_visited;
+        }
+        else
+        {
+            mazelib_carve_symmetric ( grid, width, height, x, y, odd_width ? mazelib_south : mazelib_east, images, 0 );
+        }
+        mazelib_assign_cell ( cells, cell_bytes, cells_size++, mazelib_get_cell_index ( x, y, height ) );
+    }
+    else
+    {
+        const uint8_t mirror_x = symmetry & mazelib_symmetry_mirror_x;
+        const uint8_t mirror_y = symmetry & mazelib_symmetry_mirror_y;
+        uint8_t has_axis = 0;
+
+        if ( mirror_x && odd_width )
+        {
+            const uint32_t x = width / 2;
+            for ( temp = 0; temp < height; ++temp )
+            {
+                grid[mazelib_get_cell_index ( x, ( uint32_t ) temp, height )] |= mazelib_symmetry_visited;
+                if ( temp + 1 < height )
+                {
+                    mazelib_carve_symmetric ( grid, width, height, x, ( uint32_t ) temp, mazelib_south, images, 0 );
+                }
+                mazelib_assign_cell ( cells, cell_bytes, cells_size++, mazelib_get_cell_index ( x, ( uint32_t ) temp, height ) );
+            }
+            has_axis = 1;
+        }
+        if ( mirror_y && odd_height )
+        {
+            const uint32_t y = height / 2;
+            for ( temp = 0; temp < width; ++temp )
+            {
+                if ( temp + 1 < width )
+                {
+                    mazelib_carve_symmetric ( grid, width, height, ( uint32_t ) temp, y, mazelib_east, images, 0 );
+                }
+
+                /* The cell where the two axes cross is already in the list. */
+                if ( grid[mazelib_get_cell_index ( ( uint32_t ) temp, y, height )] & mazelib_symmetry_visited )
+                {
+                    continue;
+                }
+                grid[mazelib_get_cell_index ( ( uint32_t ) temp, y, height )] |= mazelib_symmetry_visited;
+                mazelib_assign_cell ( cells, cell_bytes, cells_size++, mazelib_get_cell_index ( ( uint32_t ) temp, y, height ) );
+            }
+            has_axis = 1;
+        }
+        if ( !has_axis )
+        {
+
+            /* A single mirror axis between two columns (or rows), crossed by one passage at a random place. */
+            if ( mirror_x )
+            {
+                temp = mazelib_prng_next_in_range ( prng, height );
+                mazelib_carve_symmetric ( grid, width, height, width / 2 - 1, ( uint32_t ) temp, mazelib_east, images, 0 );
+                mazelib_assign_cell ( cells, cell_bytes, cells_size++, mazelib_get_cell_index ( width / 2 - 1, ( uint32_t ) temp, height ) );
+            }
+            else
+            {
+                temp = mazelib_prng_next_in_range ( prng, width );
+                mazelib_carve_symmetric ( grid, width, height, ( uint32_t ) temp, height / 2 - 1, mazelib_south, images, 0 );
+                mazelib_assign_cell ( cells, cell_bytes, cells_size++, mazelib_get_cell_index ( ( uint32_t ) temp, height / 2 - 1, height ) );
+            }
+        }
+    }
+
+    MAZELIB_STATS_MAX ( prng, max_frontier, cells_size );
+
+    /*
+    * From here on this is the growing tree algorithm of mazelib_generate_extended,
+    * except that every passage is carved together with its images. The set of visited cells stays symmetric,
+    * so a cell has an unvisited neighbor exactly when its images do, and only one cell of each image set needs to be in the list.
+    */
+    while ( cells_size )
+    {
+        uint32_t x, y;
+        uint64_t current_cell;
+        uint64_t cell_index = 0;
+        uint8_t found_new_neighbor = 0;
+
+        MAZELIB_STATS_ADD ( prng, steps, 1 );
+
+        if ( cells_size > 1 )
+        {
+            MAZELIB_STATS_ADD ( prng, callback_calls, 1 );
+            cell_index = cell_selection_callback ( cells_size, prng, user );
+            if ( cell_index >= cells_size )
+            {
+                MAZELIB_TRACE_END ( "carve" );
+                return 0;    /* The callback returned a value outside the allowed range, so we abort. */
+            }
+        }
+
+        current_cell = mazelib_read_cell ( cells, cell_bytes, cell_index );
+        x = ( uint32_t ) ( current_cell / height );
+        y = ( uint32_t ) ( current_cell % height );
+
+        /* Shuffle the directions. */
+        for ( i = 3; i; --i )
+        {
+            uint8_t swap_index = ( uint8_t ) mazelib_prng_next_in_range ( prng, i + 1 );
+            temp = directions[i];
+            directions[i] = directions[swap_index];
+            directions[swap_index] = temp;
+        }
+
+        for ( i = 0; i < 4; ++i )
+        {
+            uint64_t new_cell_index;
+            switch ( directions[i] )
+            {
+                case mazelib_west:
+                    if ( x == 0 )
+                    {
+                        continue;
+                    }
+                    new_cell_index = current_cell - height;
+                    break;
+                case mazelib_east:
+                    if ( x == width - 1 )
+                    {
+                        continue;
+                    }
+                    new_cell_index = current_cell + height;
+                    break;
+                case mazelib_north:
+                    if ( y == 0 )
+                    {
+                        continue;
+                    }
+                    new_cell_index = current_cell - 1;
+                    break;
+                default: /* South */
+                    if ( y == height - 1 )
+                    {
+                        continue;
+                    }
+                    new_cell_index = current_cell + 1;
+                    break;
+            };
+
+            /* If we have already visited the given cell, we don't consider it again. */
+            if ( grid[new_cell_index] )
+            {
+                continue;
+            }
+
+            found_new_neighbor = 1;
+            mazelib_carve_symmetric ( grid, width, height, x, y, directions[i], images, image_count );
+            mazelib_assign_cell ( cells, cell_bytes, cells_size, new_cell_index );
+            ++cells_size;
+            MAZELIB_STATS_MAX ( prng, max_frontier, cells_size );
+            break;
+        }
+        if ( found_new_neighbor == 0 )
+        {
+
+            /* The current cell has no unvisited neighbors, so we remove it from our list. */
+            MAZELIB_STATS_ADD ( prng, dead_end_removals, 1 );
+            if ( cell_index < cells_size - 1 )
+            {
+                MAZELIB_STATS_ADD ( prng, memmove_bytes, ( cells_size - ( cell_index + 1 ) ) * cell_bytes );
+                memmove ( ( void* ) &cells[cell_index * cell_bytes], ( void* ) &cells[ ( cell_index + 1 ) *cell_bytes], ( cells_size - ( cell_index + 1 ) ) *cell_bytes );
+            }
+            --cells_size;
+        }
+    }
+
+    /* Only cells on the axes or in the center can still carry the visited mark. */
+    if ( symmetry & mazelib_symmetry_mirror_x && odd_width )
+    {
+        for ( temp = 0; temp < height; ++temp )
+        {
+            grid[mazelib_get_cell_index ( width / 2, ( uint32_t ) temp, height )] &= ~mazelib_symmetry_visited;
+        }
+    }
+    if ( symmetry & mazelib_symmetry_mirror_y && odd_height )
+    {
+        for ( temp = 0; temp < width; ++temp )
+        {
+            grid[mazelib_get_cell_index ( ( uint32_t ) temp, height / 2, height )] &= ~mazelib_symmetry_visited;
+        }
+    }
+    if ( symmetry == mazelib_symmetry_rotate_180 )
+    {
+        grid[mazelib_get_cell_index ( ( width - 1 ) / 2, ( height - 1 ) / 2, height )] &= ~mazelib_symmetry_visited;
+    }
+
+    MAZELIB_TRACE_END ( "carve" );
+
+    if ( blockwise )
+    {
+        result = mazelib_expand_to_blockwise ( width, height, grid, output );
+    }
+
+    return result;
+}
+
+uint64_t mazelib_generate_symmetric ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, uint8_t symmetry, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_generate_symmetric_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, symmetry, blockwise, output, output_size );
+}
+
+/*
+* The route is carved one leg at a time, the short legs before the long ones, so that a short leg does not have to find its way around a long one.
+* Legs of the same bit length are carved in a random order, which changes with every attempt.
+* Each leg is a shortest path between its two waypoints, found by a breadth first search that keeps clear of the route, the border and the other waypoints,
+* and that keeps less and less clear on each tier until it finds a path. After a leg is carved, one flood of the free cells checks that the legs still
+* to be carved can reach their waypoints. If a leg fails on every tier, the attempt starts over.
+*
+* In the grid, the cells of the route carry mazelib_route_cell and their passages in the low bits, and the waypoints also carry mazelib_route_waypoint.
+* The first waypoint of each carved leg carries mazelib_route_leg_carved. Free cells keep the state of the searches in the low bits:
+* mazelib_route_searched with the index of the direction back to the cell they were reached from, or mazelib_route_flooded.
+* The list is the queue of the searches, and keeps the order of the legs at its end.
+*/
+#define mazelib_route_cell 0x10
+#define mazelib_route_waypoint 0x20
+#define mazelib_route_leg_carved 0x40
+#define mazelib_route_searched 0x04
+#define mazelib_route_flooded 0x08
+#define mazelib_route_tiers 4
+#define mazelib_route_max_attempts 32
+
+static uint64_t mazelib_get_waypoint_cell ( const uint32_t* waypoints, uint64_t waypoint_index, uint32_t height )
+{
+    return mazelib_get_cell_index ( waypoints[waypoint_index * 2], waypoints[waypoint_index * 2 + 1], height );
+}
+
+/* The position of a cell on the border of the maze, counted clockwise from the top left corner. */
+static uint64_t mazelib_get_border_position ( uint32_t width, uint32_t height, uint32_t x, uint32_t y )
+{
+    if ( y == 0 )
+    {
+        return x;
+    }
+    if ( x == width - 1 )
+    {
+        return ( uint64_t ) width - 1 + y;
+    }
+    if ( y == height - 1 )
+    {
+        return ( uint64_t ) width - 1 + ( height - 1 ) + ( width - 1 - x );
+    }
+    return ( uint64_t ) ( width - 1 ) * 2 + ( height - 1 ) + ( height - 1 - y );
+}
+
+static uint64_t mazelib_get_border_cell ( uint32_t width, uint32_t height, uint64_t position )
+{
+    if ( position < width - 1 )
+    {
+        return mazelib_get_cell_index ( ( uint32_t ) position, 0, height );
+    }
+    position -= width - 1;
+    if ( position < height - 1 )
+    {
+        return mazelib_get_cell_index ( width - 1, ( uint32_t ) position, height );
+    }
+    position -= height - 1;
+    if ( position < width - 1 )
+    {
+        return mazelib_get_cell_index ( width - 1 - ( uint32_t ) position, height - 1, height );
+    }
+    position -= width - 1;
+    return mazelib_get_cell_index ( 0, height - 1 - ( uint32_t ) position, height );
+}
+
+/*
+* Returns 0 for orders of waypoints that no route can follow: a waypoint without a free side for each of its legs,
+* waypoints out of order in a maze one cell wide, or waypoints on the border in an order that would make the route cross itself.
+* The route between two waypoints on the border cuts the maze in two, so every waypoint on the border must extend the stretch of border
+* visited so far at one of its ends, without passing over another waypoint.
+*/
+static uint8_t mazelib_is_waypoint_order_possible ( uint32_t width, uint32_t height, const uint32_t* waypoints, uint32_t waypoint_count, const uint8_t* grid )
+{
+    const uint64_t perimeter = ( ( uint64_t ) width - 1 ) * 2 + ( ( uint64_t ) height - 1 ) * 2;
+    uint64_t start = 0, end = 0, i;
+    uint8_t first = 1;
+
+    for ( i = 0; i < waypoint_count; ++i )
+    {
+        const uint64_t cell = mazelib_get_waypoint_cell ( waypoints, i, height );
+        const uint8_t legs = ( uint8_t ) ( ( i > 0 ) + ( i + 1 < waypoint_count ) );
+        uint8_t sides = 0;
+        uint8_t d;
+
+        for ( d = 0; d < 4; ++d )
+        {
+            uint64_t neighbor;
+            if ( !mazelib_get_neighbor ( width, height, cell, waypoints[i * 2], waypoints[i * 2 + 1], d, &neighbor ) )
+            {
+                continue;
+            }
+            if ( !( grid[neighbor] & mazelib_route_waypoint ) ||
+                 ( i > 0 && neighbor == mazelib_get_waypoint_cell ( waypoints, i - 1, height ) ) ||
+                 ( i + 1 < waypoint_count && neighbor == mazelib_get_waypoint_cell ( waypoints, i + 1, height ) ) )
+            {
+                ++sides;
+            }
+        }
+        if ( sides < legs )
+        {
+            return 0;
+        }
+    }
+
+    if ( width == 1 || height == 1 )
+    {
+        for ( i = 2; i < waypoint_count; ++i )
+        {
+            if ( ( mazelib_get_waypoint_cell ( waypoints, i, height ) > mazelib_get_waypoint_cell ( waypoints, i - 1, height ) ) !=
+                 ( mazelib_get_waypoint_cell ( waypoints, 1, height ) > mazelib_get_waypoint_cell ( waypoints, 0, height ) ) )
+            {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    for ( i = 0; i < waypoint_count; ++i )
+    {
+        const uint32_t x = waypoints[i * 2];
+        const uint32_t y = waypoints[i * 2 + 1];
+        uint64_t position, forward, backward;
+        uint8_t forward_open = 1;
+        uint8_t backward_open = 1;
+
+        if ( x != 0 && y != 0 && x != width - 1 && y != height - 1 )
+        {
+            continue;
+        }
+        position = mazelib_get_border_position ( width, height, x, y );
+        if ( first )
+        {
+            start = end = position;
+            first = 0;
+            continue;
+        }
+
+        /* Walk away from both ends of the stretch in step, so that the walk costs no more than twice the border it adds to the stretch. */
+        for ( forward = end, backward = start;; )
+        {
+            if ( !forward_open && !backward_open )
+            {
+                return 0;
+            }
+            if ( forward_open )
+            {
+                forward = forward + 1 == perimeter ? 0 : forward + 1;
+                if ( forward == position )
+                {
+                    end = position;
+                    break;
+                }
+                forward_open = !( grid[mazelib_get_border_cell ( width, height, forward )] & mazelib_route_waypoint );
+            }
+            if ( backward_open )
+            {
+                backward = backward == 0 ? perimeter - 1 : backward - 1;
+                if ( backward == position )
+                {
+                    start = position;
+                    break;
+                }
+                backward_open = !( grid[mazelib_get_border_cell ( width, height, backward )] & mazelib_route_waypoint );
+            }
+        }
+    }
+    return 1;
+}
+
+/* The number of bits in the distance between the waypoints of a leg. All the legs with fewer bits are carved first. */
+static uint8_t mazelib_get_leg_length_bits ( const uint32_t* waypoints, uint64_t leg )
+{
+    const uint32_t* from = waypoints + leg * 2;
+    uint64_t length = ( uint64_t ) ( from[0] > from[2] ? from[0] - from[2] : from[2] - from[0] ) + ( from[1] > from[3] ? from[1] - from[3] : from[3] - from[1] );
+    uint8_t bits = 0;
+
+    for ( ; length; length >>= 1 )
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+/*
+* Returns 1 if a leg from origin to target may go through a free cell on the given tier. Right next to its own waypoints a leg may always go.
+* Tier 3 keeps off the border, tier 2 and up keep a cell away from the route and the other waypoints, and tier 1 and up keep off the sides of the other waypoints.
+*/
+static uint8_t mazelib_route_allows ( uint32_t width, uint32_t height, const uint8_t* grid, uint64_t cell, uint64_t origin, uint64_t target, uint8_t tier )
+{
+    const uint32_t x = ( uint32_t ) ( cell / height );
+    const uint32_t y = ( uint32_t ) ( cell % height );
+    uint32_t neighbor_x, neighbor_y;
+
+    if ( ( x + 1 >= origin / height && x <= origin / height + 1 && y + 1 >= origin % height && y <= origin % height + 1 ) ||
+         ( x + 1 >= target / height && x <= target / height + 1 && y + 1 >= target % height && y <= target % height + 1 ) )
+    {
+        return 1;
+    }
+    if ( tier >= 3 && ( x == 0 || y == 0 || x == width - 1 || y == height - 1 ) )
+    {
+        return 0;
+    }
+    for ( neighbor_x = x ? x - 1 : 0; neighbor_x <= x + 1 && neighbor_x < width; ++neighbor_x )
+    {
+        for ( neighbor_y = y ? y - 1 : 0; neighbor_y <= y + 1 && neighbor_y < height; ++neighbor_y )
+        {
+            const uint8_t neighbor = grid[mazelib_get_cell_index ( neighbor_x, neighbor_y, height )];
+            if ( tier >= 2 && ( neighbor & mazelib_route_cell ) )
+            {
+                return 0;
+            }
+            if ( tier >= 1 && ( neighbor & mazelib_route_waypoint ) && ( neighbor_x == x || neighbor_y == y ) )
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+* Carve a shortest path from origin to target through the free cells that the tier allows, with the list as the queue of a breadth first search.
+* Returns 0 if there is none, and otherwise 1 and the index of the direction from the target into the leg.
+*/
+static uint8_t mazelib_carve_leg ( uint32_t width, uint32_t height, mazelib_prng* prng, uint8_t* grid, uint8_t* cells, uint8_t cell_bytes, uint64_t origin, uint64_t target, uint8_t tier, uint8_t* target_direction_index )
+{
+    uint64_t head = 0, tail = 1, i;
+    uint64_t cell = origin;
+    uint64_t noise = 0;
+    uint8_t noise_bits = 0;
+    uint8_t found = 0;
+    uint8_t passage;
+
+    mazelib_assign_cell ( cells, cell_bytes, 0, origin );
+    while ( head < tail && !found )
+    {
+        const uint64_t current = mazelib_read_cell ( cells, cell_bytes, head++ );
+        const uint32_t x = ( uint32_t ) ( current / height );
+        const uint32_t y = ( uint32_t ) ( current % height );
+        uint8_t order, j;
+
+        /* Three random bits pick one of eight orders of the neighbors, so that the search picks a random one of the shortest paths. */
+        if ( noise_bits < 3 )
+        {
+            noise = mazelib_prng_next ( prng );
+            noise_bits = 64;
+        }
+        order = ( uint8_t ) ( noise & 7 );
+        noise >>= 3;
+        noise_bits = ( uint8_t ) ( noise_bits - 3 );
+
+        for ( j = 0; j < 4; ++j )
+        {
+            const uint8_t d = ( uint8_t ) ( ( order & 4 ) ? 3 - ( ( j + order ) & 3 ) : ( j + order ) & 3 );
+            uint64_t neighbor;
+
+            if ( !mazelib_get_neighbor ( width, height, current, x, y, d, &neighbor ) )
+            {
+                continue;
+            }
+            if ( neighbor == target )
+            {
+                cell = current;
+                *target_direction_index = ( uint8_t ) ( d ^ 1 );
+                found = 1;
+                break;
+            }
+            if ( ( grid[neighbor] & ( mazelib_route_cell | mazelib_route_searched ) ) || !mazelib_route_allows ( width, height, grid, neighbor, origin, target, tier ) )
+            {
+                continue;
+            }
+            grid[neighbor] = ( uint8_t ) ( mazelib_route_searched | ( d ^ 1 ) );
+            mazelib_assign_cell ( cells, cell_bytes, tail++, neighbor );
+        }
+    }
+
+    if ( found )
+    {
+        /* Follow the directions back from the target, turning the cells on the way into route cells. */
+        grid[target] |= ( uint8_t ) ( 1 << *target_direction_index );
+        for ( passage = ( uint8_t ) ( *target_direction_index ^ 1 ); cell != origin; )
+        {
+            const uint8_t back = ( uint8_t ) ( grid[cell] & 3 );
+            uint64_t previous;
+            mazelib_get_neighbor ( width, height, cell, ( uint32_t ) ( cell / height ), ( uint32_t ) ( cell % height ), back, &previous );
+            grid[cell] = ( uint8_t ) ( mazelib_route_cell | ( 1 << passage ) | ( 1 << back ) );
+            passage = ( uint8_t ) ( back ^ 1 );
+            cell = previous;
+        }
+        grid[origin] |= ( uint8_t ) ( 1 << passage );
+    }
+
+    /* Forget the search. The cells of the new leg are route cells now and keep their passages. */
+    for ( i = 0; i < tail; ++i )
+    {
+        cell = mazelib_read_cell ( cells, cell_bytes, i );
+        if ( !( grid[cell] & mazelib_route_cell ) )
+        {
+            grid[cell] = 0;
+        }
+    }
+    return found;
+}
+
+/* Take a leg out again, following its passages from the target back to the origin. */
+static void mazelib_uncarve_leg ( uint32_t width, uint32_t height, uint8_t* grid, uint64_t origin, uint64_t target, uint8_t target_direction_index )
+{
+    uint8_t d = target_direction_index;
+    uint64_t cell;
+
+    grid[target] &= ( uint8_t ) ~( 1 << d );
+    mazelib_get_neighbor ( width, height, target, ( uint32_t ) ( target / height ), ( uint32_t ) ( target % height ), d, &cell );
+    while ( cell != origin )
+    {
+        uint8_t forward;
+        for ( forward = 0; forward == ( d ^ 1 ) || !( grid[cell] & ( 1 << forward ) ); ++forward )
+        {
+        }
+        grid[cell] = 0;
+        d = forward;
+        mazelib_get_neighbor ( width, height, cell, ( uint32_t ) ( cell / height ), ( uint32_t ) ( cell % height ), d, &cell );
+    }
+    grid[origin] &= ( uint8_t ) ~( 1 << ( d ^ 1 ) );
+}
+
+/* Returns 1 if the leg has not been carved yet. */
+static uint8_t mazelib_is_leg_pending ( const uint8_t* grid, const uint32_t* waypoints, uint32_t waypoint_count, uint32_t height, uint64_t leg )
+{
+    return leg + 1 < waypoint_count && !( grid[mazelib_get_waypoint_cell ( waypoints, leg, height )] & mazelib_route_leg_carved );
+}
+
+/*
+* Check that the legs still to be carved can reach their waypoints, with one flood of the free cells from a side of one of them.
+* Every waypoint needs a side for each of its legs still to be carved: a free cell the flood reached, or the other waypoint of the leg right next to it.
+* Demanding a single flood is stricter than needed, but it keeps every waypoint within reach of the legs that are still missing.
+*/
+static uint8_t mazelib_check_pending_legs ( uint32_t width, uint32_t height, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t* grid, uint8_t* cells, uint8_t cell_bytes )
+{
+    uint64_t head = 0, tail = 0, i;
+    uint8_t result = 1;
+    uint8_t d;
+
+    for ( i = 0; i / 2 + 1 < waypoint_count && tail == 0; ++i )
+    {
+        const uint64_t waypoint = i / 2 + i % 2;
+        const uint64_t cell = mazelib_get_waypoint_cell ( waypoints, waypoint, height );
+        if ( !mazelib_is_leg_pending ( grid, waypoints, waypoint_count, height, i / 2 ) )
+        {
+            continue;
+        }
+        for ( d = 0; d < 4; ++d )
+        {
+            uint64_t neighbor;
+            if ( mazelib_get_neighbor ( width, height, cell, waypoints[waypoint * 2], waypoints[waypoint * 2 + 1], d, &neighbor ) && !( grid[neighbor] & mazelib_route_cell ) )
+            {
+                grid[neighbor] = mazelib_route_flooded;
+                mazelib_assign_cell ( cells, cell_bytes, tail++, neighbor );
+                break;
+            }
+        }
+    }
+    while ( head < tail )
+    {
+        const uint64_t current = mazelib_read_cell ( cells, cell_bytes, head++ );
+        const uint32_t x = ( uint32_t ) ( current / height );
+        const uint32_t y = ( uint32_t ) ( current % height );
+        for ( d = 0; d < 4; ++d )
+        {
+            uint64_t neighbor;
+            if ( mazelib_get_neighbor ( width, height, current, x, y, d, &neighbor ) && !( grid[neighbor] & ( mazelib_route_cell | mazelib_route_flooded ) ) )
+            {
+                grid[neighbor] = mazelib_route_flooded;
+                mazelib_assign_cell ( cells, cell_bytes, tail++, neighbor );
+            }
+        }
+    }
+
+    for ( i = 0; i < waypoint_count && result; ++i )
+    {
+        const uint64_t cell = mazelib_get_waypoint_cell ( waypoints, i, height );
+        const uint8_t before = ( uint8_t ) ( i > 0 && mazelib_is_leg_pending ( grid, waypoints, waypoint_count, height, i - 1 ) );
+        const uint8_t after = mazelib_is_leg_pending ( grid, waypoints, waypoint_count, height, i );
+        uint8_t sides = 0;
+
+        if ( !before && !after )
+        {
+            continue;
+        }
+        for ( d = 0; d < 4; ++d )
+        {
+            uint64_t neighbor;
+            if ( !mazelib_get_neighbor ( width, height, cell, waypoints[i * 2], waypoints[i * 2 + 1], d, &neighbor ) )
+            {
+                continue;
+            }
+            if ( ( grid[neighbor] & mazelib_route_flooded ) ||
+                 ( before && neighbor == mazelib_get_waypoint_cell ( waypoints, i - 1, height ) ) ||
+                 ( after && neighbor == mazelib_get_waypoint_cell ( waypoints, i + 1, height ) ) )
+            {
+                ++sides;
+            }
+        }
+        if ( sides < before + after )
+        {
+            result = 0;
+        }
+    }
+
+    for ( i = 0; i < tail; ++i )
+    {
+        grid[mazelib_read_cell ( cells, cell_bytes, i )] = 0;
+    }
+    return result;
+}
+
+/*
+* Carve one leg on the first tier that gives a path which leaves the legs still to be carved within reach of their waypoints.
+* Returns 0 if there is no such tier.
+*/
+static uint8_t mazelib_route_leg ( uint32_t width, uint32_t height, mazelib_prng* prng, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t* grid, uint8_t* cells, uint8_t cell_bytes, uint64_t leg )
+{
+    const uint64_t origin = mazelib_get_waypoint_cell ( waypoints, leg, height );
+    const uint64_t target = mazelib_get_waypoint_cell ( waypoints, leg + 1, height );
+    uint8_t tier, target_direction_index = 0;
+
+    for ( tier = mazelib_route_tiers; tier > 0; --tier )
+    {
+        if ( !mazelib_carve_leg ( width, height, prng, grid, cells, cell_bytes, origin, target, ( uint8_t ) ( tier - 1 ), &target_direction_index ) )
+        {
+            continue;
+        }
+        grid[origin] |= mazelib_route_leg_carved;
+        if ( mazelib_check_pending_legs ( width, height, waypoints, waypoint_count, grid, cells, cell_bytes ) )
+        {
+            return 1;
+        }
+        grid[origin] &= ( uint8_t ) ~mazelib_route_leg_carved;
+        mazelib_uncarve_leg ( width, height, grid, origin, target, target_direction_index );
+    }
+    return 0;
+}
+
+/*
+* Carve the route through all the waypoints and put its cells into the list, in order from the first waypoint to the last.
+* Returns the number of cells in the route, or 0 if no attempt found one.
+*/
+static uint64_t mazelib_route_waypoints ( uint32_t width, uint32_t height, mazelib_prng* prng, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t* grid, uint8_t* cells, uint8_t cell_bytes )
+{
+    const uint64_t area = ( uint64_t ) width * height;
+    const uint64_t legs = waypoint_count - 1;
+    const uint64_t order = area - legs;
+    uint64_t cell, previous, cells_size, i;
+    uint32_t attempt;
+    uint8_t failed = 1;
+
+    for ( attempt = 0; attempt < mazelib_route_max_attempts && failed; ++attempt )
+    {
+        uint8_t length_bits;
+
+        failed = 0;
+        if ( attempt > 0 )
+        {
+            for ( i = 0; i < area; ++i )
+            {
+                grid[i] = ( grid[i] & mazelib_route_waypoint ) ? mazelib_route_cell | mazelib_route_waypoint : 0;
+            }
+        }
+        for ( i = 0; i < legs; ++i )
+        {
+            const uint64_t swap_index = mazelib_prng_next_in_range ( prng, i + 1 );
+            if ( swap_index != i )
+            {
+                mazelib_assign_cell ( cells, cell_bytes, order + i, mazelib_read_cell ( cells, cell_bytes, order + swap_index ) );
+            }
+            mazelib_assign_cell ( cells, cell_bytes, order + swap_index, i );
+        }
+
+        for ( length_bits = 1; length_bits <= 64 && !failed; ++length_bits )
+        {
+            for ( i = 0; i < legs && !failed; ++i )
+            {
+                const uint64_t leg = mazelib_read_cell ( cells, cell_bytes, order + i );
+                if ( mazelib_get_leg_length_bits ( waypoints, leg ) == length_bits )
+                {
+                    failed = ( uint8_t ) !mazelib_route_leg ( width, height, prng, waypoints, waypoint_count, grid, cells, cell_bytes, leg );
+                }
+            }
+        }
+    }
+    if ( failed )
+    {
+        return 0;
+    }
+
+    /* The passages now form a single path from the first waypoint to the last, so follow it to fill the list. */
+    cell = mazelib_get_waypoint_cell ( waypoints, 0, height );
+    previous = cell;
+    for ( cells_size = 0;; )
+    {
+        const uint32_t x = ( uint32_t ) ( cell / height );
+        const uint32_t y = ( uint32_t ) ( cell % height );
+        uint64_t next = cell;
+        uint8_t d;
+
+        mazelib_assign_cell ( cells, cell_bytes, cells_size++, cell );
+        for ( d = 0; d < 4; ++d )
+        {
+            if ( ( grid[cell] & ( 1 << d ) ) && mazelib_get_neighbor ( width, height, cell, x, y, d, &next ) && next != previous )
+            {
+                break;
+            }
+        }
+        if ( d == 4 )
+        {
+            break;
+        }
+        previous = cell;
+        cell = next;
+    }
+    return cells_size;
+}
+
+uint64_t mazelib_generate_with_waypoints_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    uint64_t result, i;
+    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
+    const uint8_t cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
+    uint8_t* cells;
+    uint8_t* grid;
+    uint64_t cells_size;
+    uint64_t high_water = 0;
+    uint64_t moved_bytes = 0;
+
+    if ( output == NULL || waypoints == NULL || waypoint_count == 0 )
+    {
+        return 0;
+    }
+    if ( output_size < required_size || required_size == 0 )
+    {
+        return 0;
+    }
+    if ( prng == NULL )
+    {
+        return 0;
+    }
+    if ( cell_selection_callback == NULL )
+    {
+        return 0;
+    }
+
+    output_size = required_size;
+
+    result = width;
+    result *= height;
+
+#ifdef MAZELIB_STATS
+    memset ( &prng->stats, 0, sizeof ( prng->stats ) );
+#endif
+
+    /* The same layout as for mazelib_generate_extended. */
+    if ( blockwise )
+    {
+        grid = output + output_size;
+        grid -= result;
+        cells = output;
+    }
+    else
+    {
+        grid = output;
+        cells = output + result;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "clear" );
+    mazelib_get_kernels ()->fill ( grid, 0, result );
+    MAZELIB_TRACE_END ( "clear" );
+
+    /* Mark all the waypoints up front, so that no leg of the route passes through another waypoint. */
+    for ( i = 0; i < waypoint_count; ++i )
+    {
+        const uint32_t x = waypoints[i * 2];
+        const uint32_t y = waypoints[i * 2 + 1];
+        if ( x >= width || y >= height || grid[mazelib_get_cell_index ( x, y, height )] )
+        {
+            return 0;
+        }
+        grid[mazelib_get_cell_index ( x, y, height )] = mazelib_route_cell | mazelib_route_waypoint;
+    }
+    if ( !mazelib_is_waypoint_order_possible ( width, height, waypoints, waypoint_count, grid ) )
+    {
+        return 0;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "carve" );
+
+    cells_size = mazelib_route_waypoints ( width, height, prng, waypoints, waypoint_count, grid, cells, cell_bytes );
+    if ( cells_size == 0 )
+    {
+        MAZELIB_TRACE_END ( "carve" );
+        return 0;
+    }
+
+    /* Grow the rest of the maze from every cell of the route at once. */
+    high_water = cells_size;
+    if ( !mazelib_grow_tree ( width, height, prng, cell_selection_callback, user, grid, cells, cell_bytes, cells_size, &high_water, &moved_bytes, NULL, NULL, 0 ) )
+    {
+        MAZELIB_TRACE_END ( "carve" );
+        return 0;
+    }
+    for ( i = 0; i < result; ++i )
+    {
+        grid[i] &= 15;
+    }
+
+    MAZELIB_TRACE_END ( "carve" );
+
+    if ( blockwise )
+    {
+        result = mazelib_expand_to_blockwise ( width, height, grid, output );
+    }
+
+    return result;
+}
+
+uint64_t mazelib_generate_with_waypoints ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, const uint32_t* waypoints, uint32_t waypoint_count, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_generate_with_waypoints_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, waypoints, waypoint_count, blockwise, output, output_size );
+}
+
+uint64_t mazelib_complete_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, const uint8_t* locked_walls, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    uint64_t result, i, temp;
+    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
+    const uint8_t cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
+    uint8_t* cells;
+    uint8_t* grid;
+    uint64_t cells_size = 0;
+    uint64_t high_water = 0;
+    uint64_t moved_bytes = 0;
+    uint32_t x, y;
+
+    if ( output == NULL )
+    {
+        return 0;
+    }
+    if ( output_size < required_size || required_size == 0 )
+    {
+        return 0;
+    }
+    if ( prng == NULL )
+    {
+        return 0;
+    }
+    if ( cell_selection_callback == NULL )
+    {
+        return 0;
+    }
+
+    output_size = required_size;
+
+#ifdef MAZELIB_STATS
+    memset ( &prng->stats, 0, sizeof ( prng->stats ) );
+#endif
+
+    result = width;
+    result *= height;
+
+    /* The same layout as for mazelib_generate_extended, so a blockwise maze first has to move out of the way of the list. */
+    if ( blockwise )
+    {
+        grid = output + output_size;
+        grid -= result;
+        cells = output;
+        memmove ( grid, output, ( size_t ) result );
+    }
+    else
+    {
+        grid = output;
+        cells = output + result;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "carve" );
+
+    /* Every passage must be carved on both sides, stay inside the maze and not go through a locked wall. */
+    for ( i = 0, x = 0; x < width; ++x )
+    {
+        for ( y = 0; y < height; ++y, ++i )
+        {
+            uint8_t d;
+            if ( grid[i] & 0xf0 )
+            {
+                MAZELIB_TRACE_END ( "carve" );
+                return 0;
+            }
+            for ( d = 0; d < 4; ++d )
+            {
+                uint64_t neighbor;
+                if ( ! ( grid[i] & ( 1 << d ) ) )
+                {
+                    continue;
+                }
+                if ( !mazelib_get_neighbor ( width, height, i, x, y, d, &neighbor ) || ! ( grid[neighbor] & ( 1 << ( d ^ 1 ) ) ) )
+                {
+                    MAZELIB_TRACE_END ( "carve" );
+                    return 0;
+                }
+                if ( locked_walls && ( ( locked_walls[i] & ( 1 << d ) ) || ( locked_walls[neighbor] & ( 1 << ( d ^ 1 ) ) ) ) )
+                {
+                    MAZELIB_TRACE_END ( "carve" );
+                    return 0;
+                }
+            }
+        }
+    }
+
+    /* Flood every carved group once, which finds the loops before any carving. */
+    for ( i = 0; i < result; ++i )
+    {
+        if ( ! ( grid[i] & mazelib_completion_visited ) && !mazelib_add_carved_group ( width, height, grid, cells, cell_bytes, &cells_size, i ) )
+        {
+            MAZELIB_TRACE_END ( "carve" );
+            return 0;
+        }
+    }
+    for ( i = 0; i < result; ++i )
+    {
+        grid[i] &= 15;
+    }
+
+    /* A breadth first search through every wall that is not locked, using the list as its queue, finds the cells the locked walls keep out of reach. */
+    grid[0] |= mazelib_completion_visited;
+    mazelib_assign_cell ( cells, cell_bytes, 0, 0 );
+    for ( temp = 0, cells_size = 1; temp < cells_size; ++temp )
+    {
+        const uint64_t cell = mazelib_read_cell ( cells, cell_bytes, temp );
+        uint8_t d;
+
+        x = ( uint32_t ) ( cell / height );
+        y = ( uint32_t ) ( cell % height );
+        for ( d = 0; d < 4; ++d )
+        {
+            uint64_t neighbor;
+            if ( !mazelib_get_neighbor ( width, height, cell, x, y, d, &neighbor ) || ( grid[neighbor] & mazelib_completion_visited ) )
+            {
+                continue;
+            }
+            if ( locked_walls && ( ( locked_walls[cell] & ( 1 << d ) ) || ( locked_walls[neighbor] & ( 1 << ( d ^ 1 ) ) ) ) )
+            {
+                continue;
+            }
+            grid[neighbor] |= mazelib_completion_visited;
+            mazelib_assign_cell ( cells, cell_bytes, cells_size++, neighbor );
+        }
+    }
+    for ( i = 0; i < result; ++i )
+    {
+        grid[i] &= 15;
+    }
+    if ( cells_size != result )
+    {
+        MAZELIB_TRACE_END ( "carve" );
+        return 0;
+    }
+
+    /* Start with the group of a random cell, drawing the row before the column as mazelib_generate_extended does. */
+    temp = mazelib_prng_next_in_range ( prng, height );
+    temp = mazelib_get_cell_index ( ( uint32_t ) mazelib_prng_next_in_range ( prng, width ), ( uint32_t ) temp, height );
+    cells_size = 0;
+    mazelib_add_carved_group ( width, height, grid, cells, cell_bytes, &cells_size, temp );    /* The loops have been ruled out above. */
+    high_water = cells_size;
+    if ( !mazelib_grow_tree ( width, height, prng, cell_selection_callback, user, grid, cells, cell_bytes, cells_size, &high_water, &moved_bytes, NULL, locked_walls, 1 ) )
+    {
+        MAZELIB_TRACE_END ( "carve" );
+        return 0;
+    }
+
+    MAZELIB_TRACE_END ( "carve" );
+
+    for ( i = 0; i < result; ++i )
+    {
+        grid[i] &= 15;
+    }
+
+    if ( blockwise )
+    {
+        result = mazelib_expand_to_blockwise ( width, height, grid, output );
+    }
+
+    return result;
+}
+
+uint64_t mazelib_complete ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, const uint8_t* locked_walls, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_complete_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, locked_walls, blockwise, output, output_size );
+}
+
+uint64_t mazelib_get_tile_library_size ( uint32_t tile_size, uint32_t variants )
+{
+    uint64_t result = tile_size;
+    result *= tile_size;
+
+    if ( tile_size < 2 || variants == 0 || tile_size > 0xffff )
+    {
+        return 0;
+    }
+
+    /* The last tile is generated in place like the others, so its list needs room after it. */
+    return result * variants + result * mazelib_get_cell_bytes_required_for_dimensions ( tile_size, tile_size );
+}
+
+uint64_t mazelib_build_tile_library_extended ( uint32_t tile_size, uint32_t variants, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t* library, uint64_t library_size )
+{
+    const uint64_t required_size = mazelib_get_tile_library_size ( tile_size, variants );
+    uint64_t tile_area = tile_size;
+    uint32_t i;
+
+    if ( library == NULL || required_size == 0 || library_size < required_size )
+    {
+        return 0;
+    }
+
+    /* Each tile's list spills over into the tiles that follow, which have not been generated yet. */
+    tile_area *= tile_size;
+    for ( i = 0; i < variants; ++i )
+    {
+        if ( !mazelib_generate_extended ( tile_size, tile_size, prng, cell_selection_callback, user, 0, library + tile_area * i, required_size - tile_area * i ) )
+        {
+            return 0;
+        }
+    }
+    return tile_area * variants;
+}
+
+uint64_t mazelib_build_tile_library ( uint32_t tile_size, uint32_t variants, uint64_t random_seed, int8_t random_threshold_percent, uint8_t* library, uint64_t library_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_build_tile_library_extended ( tile_size, variants, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, library, library_size );
+}
+
+uint64_t mazelib_generate_tiled_extended ( uint32_t width, uint32_t height, const uint8_t* library, uint32_t tile_size, uint32_t variants, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    uint64_t result, cell, tile_area;
+    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
+    uint32_t tiles_x, tiles_y, tile_x, tile_y, column;
+    uint8_t* coarse;
+    uint8_t* grid;
+
+    if ( output == NULL || library == NULL )
+    {
+        return 0;
+    }
+    if ( output_size < required_size || required_size == 0 )
+    {
+        return 0;
+    }
+    if ( mazelib_get_tile_library_size ( tile_size, variants ) == 0 || width % tile_size || height % tile_size )
+    {
+        return 0;
+    }
+
+    output_size = required_size;
+
+    result = width;
+    result *= height;
+    tile_area = tile_size;
+    tile_area *= tile_size;
+    tiles_x = width / tile_size;
+    tiles_y = height / tile_size;
+
+    /*
+    * The same layout as for mazelib_generate_extended, with the coarse maze (and its own list) where the list would be.
+    * With tiles of at least 2 by 2 cells, the coarse maze has at most a quarter as many cells, so it always fits.
+    */
+    if ( blockwise )
+    {
+        grid = output + output_size;
+        grid -= result;
+        coarse = output;
+    }
+    else
+    {
+        grid = output;
+        coarse = output + result;
+    }
+
+    if ( !mazelib_generate_extended ( tiles_x, tiles_y, prng, cell_selection_callback, user, 0, coarse, mazelib_get_required_buffer_size ( tiles_x, tiles_y, 0 ) ) )
+    {
+        return 0;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "stamp" );
+
+    /*
+    * Copy the tiles one column at a time, since the columns of a tile are not next to each other in the maze.
+    * Each tile then opens the walls towards its western and northern neighbors, which have already been copied and are still in the cache,
+    * at a random place along the shared edge of every passage of the coarse maze.
+    */
+    for ( cell = 0, tile_x = 0; tile_x < tiles_x; ++tile_x )
+    {
+        for ( tile_y = 0; tile_y < tiles_y; ++tile_y, ++cell )
+        {
+            const uint8_t* tile = library + tile_area * mazelib_prng_next_in_range ( prng, variants );
+            const uint64_t corner = mazelib_get_cell_index ( tile_x * tile_size, tile_y * tile_size, height );
+            uint8_t* destination = grid + corner;
+
+            /* The common size gets its own loop, where the compiler can replace each memcpy with a single 16 byte move. */
+            if ( tile_size == 16 )
+            {
+                for ( column = 0; column < 16; ++column )
+                {
+                    memcpy ( destination, tile, 16 );
+                    destination += height;
+                    tile += 16;
+                }
+            }
+            else
+            {
+                for ( column = 0; column < tile_size; ++column )
+                {
+                    memcpy ( destination, tile, tile_size );
+                    destination += height;
+                    tile += tile_size;
+                }
+            }
+            if ( coarse[cell] & mazelib_west )
+            {
+                const uint64_t index = corner + mazelib_prng_next_in_range ( prng, tile_size );
+                grid[index] |= mazelib_west;
+                grid[index - height] |= mazelib_east;
+            }
+            if ( coarse[cell] & mazelib_north )
+            {
+                const uint64_t index = corner + height * mazelib_prng_next_in_range ( prng, tile_size );
+                grid[index] |= mazelib_north;
+                grid[index - 1] |= mazelib_south;
+            }
+        }
+    }
+
+    MAZELIB_TRACE_END ( "stamp" );
+
+    if ( blockwise )
+    {
+        result = mazelib_expand_to_blockwise ( width, height, grid, output );
+    }
+
+    return result;
+}
+
+uint64_t mazelib_generate_tiled ( uint32_t width, uint32_t height, const uint8_t* library, uint32_t tile_size, uint32_t variants, uint64_t random_seed, int8_t random_threshold_percent, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_generate_tiled_extended ( width, height, library, tile_size, variants, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, blockwise, output, output_size );
+}
+
+uint64_t mazelib_get_carve_log_size ( uint32_t width, uint32_t height )
+{
+    uint64_t area = width;
+    uint64_t largest;
+    uint64_t varint_bytes = 1;
+
+    area *= height;
+    if ( area == 0 )
+    {
+        return 0;
+    }
+
+    /* Neither the first cell nor a distance between two cells (with the sign folded in) can exceed twice the number of cells. */
+    for ( largest = area * 2; largest >= 0x80; largest >>= 7 )
+    {
+        ++varint_bytes;
+    }
+    return varint_bytes + ( area - 1 ) * ( 1 + varint_bytes );
+}
+
+uint64_t mazelib_generate_recorded_extended ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_cell_selection_callback cell_selection_callback, void* user, mazelib_carve_log* log, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    uint64_t area = width;
+    area *= height;
+
+    if ( log == NULL || log->data == NULL )
+    {
+        return 0;
+    }
+    if ( log->visit_order && area > 0xffffffff )
+    {
+        return 0;
+    }
+    if ( log->keyframe_interval && log->keyframes == NULL )
+    {
+        return 0;
+    }
+
+    log->size = 0;
+    log->events = 0;
+    log->keyframe_count = 0;
+    log->last_cell = 0;
+
+    return mazelib_generate_logged ( width, height, prng, cell_selection_callback, user, blockwise, output, output_size, NULL, log );
+}
+
+uint64_t mazelib_generate_recorded ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, mazelib_carve_log* log, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    mazelib_prng prng;
+
+    mazelib_prng_seed ( &prng, random_seed );
+
+    if ( random_threshold_percent < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else if ( random_threshold_percent > 100 )
+    {
+        random_threshold_percent = 100;
+    }
+
+    return mazelib_generate_recorded_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, log, blockwise, output, output_size );
+}
+
+/* Decode the passage at *offset, which was carved after reaching *last_cell. Sets from and to, advances both and returns the direction from from to to. */
+static uint8_t mazelib_decode_carve ( const uint8_t* data, uint32_t height, uint64_t* offset, uint64_t* last_cell, uint64_t* from, uint64_t* to )
+{
+    const uint8_t byte = data[( *offset )++];
+    uint64_t distance = byte >> 2;
+
+    if ( distance == 63 )
+    {
+        distance += mazelib_get_varint ( data, offset );
+    }
+    *from = *last_cell + ( ( distance >> 1 ) ^ ( 0 - ( distance & 1 ) ) );
+    switch ( byte & 3 )
+    {
+        case 0:
+            *to = *from - height;
+            break;
+        case 1:
+            *to = *from + height;
+            break;
+        case 2:
+            *to = *from - 1;
+            break;
+        default:
+            *to = *from + 1;
+            break;
+    };
+    *last_cell = *to;
+    return ( uint8_t ) ( 1 << ( byte & 3 ) );
+}
+
+uint8_t mazelib_replay_begin ( mazelib_replay* replay, const mazelib_carve_log* log, uint32_t width, uint32_t height, uint8_t* grid )
+{
+    uint64_t area = width;
+    area *= height;
+
+    if ( replay == NULL || log == NULL || log->data == NULL || log->size == 0 || grid == NULL || area == 0 )
+    {
         return 0;
     }
-    if ( prng == NULL )
+
+    mazelib_get_kernels ()->fill ( grid, 0, area );
+    replay->log = log;
+    replay->grid = grid;
+    replay->height = height;
+    replay->event = 0;
+    replay->offset = 0;
+    replay->last_cell = mazelib_get_varint ( log->data, &replay->offset );
+    return 1;
+}
+
+uint64_t mazelib_replay_seek ( mazelib_replay* replay, uint64_t event )
+{
+    const mazelib_carve_log* log = replay->log;
+    uint64_t from, to, offset, last_cell, current;
+    uint8_t direction;
+
+    if ( event > log->events )
+    {
+        event = log->events;
+    }
+
+    while ( replay->event < event )
+    {
+        direction = mazelib_decode_carve ( log->data, replay->height, &replay->offset, &replay->last_cell, &from, &to );
+        replay->grid[from] |= direction;
+        replay->grid[to] |= ( uint8_t ) ( direction & 5 ? direction << 1 : direction >> 1 );
+        ++replay->event;
+    }
+    if ( replay->event == event )
+    {
+        return event;
+    }
+
+    /* Going back, decode from the nearest keyframe and remove every passage from the target onwards. Each passage was carved exactly once, so clearing its bits undoes it. */
+    if ( log->keyframe_count )
+    {
+        uint64_t keyframe = event / log->keyframe_interval;
+        if ( keyframe >= log->keyframe_count )
+        {
+            keyframe = log->keyframe_count - 1;
+        }
+        current = keyframe * log->keyframe_interval;
+        offset = log->keyframes[keyframe * 2];
+        last_cell = log->keyframes[keyframe * 2 + 1];
+    }
+    else
+    {
+        current = 0;
+        offset = 0;
+        last_cell = mazelib_get_varint ( log->data, &offset );
+    }
+    for ( ; current < replay->event; ++current )
+    {
+        if ( current == event )
+        {
+            replay->offset = offset;
+            replay->last_cell = last_cell;
+        }
+        direction = mazelib_decode_carve ( log->data, replay->height, &offset, &last_cell, &from, &to );
+        if ( current >= event )
+        {
+            replay->grid[from] &= ( uint8_t ) ~direction;
+            replay->grid[to] &= ( uint8_t ) ~( direction & 5 ? direction << 1 : direction >> 1 );
+        }
+    }
+    replay->event = event;
+    return event;
+}
+
+uint64_t mazelib_get_frontier_cell ( const mazelib_frontier_view* frontier, uint64_t index )
+{
+    switch ( frontier->cell_bytes )
+    {
+        case 1:
+            return frontier->cells.u8[index];
+        case 2:
+            return frontier->cells.u16[index];
+        case 4:
+            return frontier->cells.u32[index];
+        default:
+            return frontier->cells.u64[index];
+    };
+}
+
+/* The user pointer that mazelib_generate_with_frontier hands to mazelib_generate_extended, so that the frontier callback can be called through the ordinary one. */
+typedef struct mazelib_frontier_selection mazelib_frontier_selection;
+struct mazelib_frontier_selection
+{
+    mazelib_frontier_view view;
+    mazelib_frontier_selection_callback callback;
+    void* user;
+};
+
+static uint64_t mazelib_frontier_selection_trampoline ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    mazelib_frontier_selection* selection = ( mazelib_frontier_selection* ) user;
+    selection->view.count = count;
+    return selection->callback ( &selection->view, prng, selection->user );
+}
+
+uint64_t mazelib_generate_with_frontier ( uint32_t width, uint32_t height, mazelib_prng* prng, mazelib_frontier_selection_callback frontier_selection_callback, void* user, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+{
+    const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, blockwise );
+    mazelib_frontier_selection selection;
+    uint64_t area = width;
+
+    if ( output == NULL || frontier_selection_callback == NULL || required_size == 0 || output_size < required_size )
     {
         return 0;
     }
-    if ( cell_selection_callback == NULL )
+
+    /* The list and the grid sit where mazelib_generate_extended puts them, and never move while it runs. */
+    area *= height;
+    selection.view.cells.u8 = blockwise ? output : output + area;
+    selection.view.count = 0;
+    selection.view.cell_bytes = mazelib_get_cell_bytes_required_for_dimensions ( width, height );
+    selection.view.grid = blockwise ? output + required_size - area : output;
+    selection.view.width = width;
+    selection.view.height = height;
+    selection.callback = frontier_selection_callback;
+    selection.user = user;
+
+    return mazelib_generate_extended ( width, height, prng, mazelib_frontier_selection_trampoline, ( void* ) &selection, blockwise, output, output_size );
+}
+
+uint64_t mazelib_get_distances ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t start_x, uint32_t start_y, uint32_t* distances, uint32_t* scratch )
+{
+    uint64_t area, i;
+    uint32_t head = 0;
+    uint32_t tail = 0;
+
+    if ( grid == NULL || distances == NULL || scratch == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 || start_x >= width || start_y >= height )
+    {
+        return 0;
+    }
+    area = width;
+    area *= height;
+    if ( area >= mazelib_unreachable )
     {
         return 0;
     }
 
-    output_size = required_size;
+    MAZELIB_TRACE_BEGIN ( "distances" );
 
-    result = width;
-    result *= height;
+    for ( i = 0; i < area; ++i )
+    {
+        distances[i] = mazelib_unreachable;
+    }
 
-    if ( blockwise )
+    /* The scratch buffer is used as the queue. Every cell is queued at most once, so it never wraps. */
+    scratch[tail++] = ( uint32_t ) mazelib_get_cell_index ( start_x, start_y, height );
+    distances[scratch[0]] = 0;
+    while ( head < tail )
     {
+        const uint32_t cell = scratch[head++];
+        const uint32_t x = cell / height;
+        const uint32_t y = cell % height;
+        const uint32_t next_distance = distances[cell] + 1;
+        const uint8_t directions = grid[cell];
 
-        /* If we are generating a blockwise maze, we put the temporary storage at the beginning so that we can then override it with the final result at the end. */
-        grid = output + output_size;
-        grid -= result;
-        cells = output;
+        if ( ( directions & mazelib_west ) && x > 0 && distances[cell - height] == mazelib_unreachable )
+        {
+            distances[cell - height] = next_distance;
+            scratch[tail++] = cell - height;
+        }
+        if ( ( directions & mazelib_east ) && x < width - 1 && distances[cell + height] == mazelib_unreachable )
+        {
+            distances[cell + height] = next_distance;
+            scratch[tail++] = cell + height;
+        }
+        if ( ( directions & mazelib_north ) && y > 0 && distances[cell - 1] == mazelib_unreachable )
+        {
+            distances[cell - 1] = next_distance;
+            scratch[tail++] = cell - 1;
+        }
+        if ( ( directions & mazelib_south ) && y < height - 1 && distances[cell + 1] == mazelib_unreachable )
+        {
+            distances[cell + 1] = next_distance;
+            scratch[tail++] = cell + 1;
+        }
+    }
+
+    MAZELIB_TRACE_END ( "distances" );
+    return tail;
+}
+
+/*
+* Components are found with a union-find forest which is stored in the labels array itself.
+* Every cell points to a cell with a lower index in the same component (or to itself if it is the lowest one, the root),
+* so that a single pass in index order can turn the forest into the final labels.
+*/
+static uint32_t mazelib_find_component ( uint32_t* parents, uint32_t cell )
+{
+
+    /* Path halving: every other cell on the way is pointed at its grandparent. */
+    while ( parents[cell] != cell )
+    {
+        parents[cell] = parents[parents[cell]];
+        cell = parents[cell];
+    }
+    return cell;
+}
+
+/* Join the components of two cells and return 1, or return 0 if they were already the same. */
+static uint8_t mazelib_join_components ( uint32_t* parents, uint32_t a, uint32_t b )
+{
+    a = mazelib_find_component ( parents, a );
+    b = mazelib_find_component ( parents, b );
+    if ( a == b )
+    {
+        return 0;
+    }
+    if ( a < b )
+    {
+        parents[b] = a;
     }
     else
     {
+        parents[a] = b;
+    }
+    return 1;
+}
 
-        /* If we are not generating a blockwise maze, we put the grid at the beginning since that will be our final result. */
-        grid = output;
-        cells = output + result;
+static uint8_t mazelib_check_component_parameters ( uint32_t width, uint32_t height, const uint8_t* grid, const uint32_t* labels )
+{
+    uint64_t area;
+    if ( grid == NULL || labels == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 )
+    {
+        return 0;
     }
+    area = width;
+    area *= height;
+    return area < mazelib_unreachable;
+}
 
-    directions[0] = mazelib_west;
-    directions[1] = mazelib_east;
-    directions[2] = mazelib_north;
-    directions[3] = mazelib_south;
+uint64_t mazelib_mark_path ( uint32_t width, uint32_t height, const uint8_t* grid, const uint32_t* distances, uint32_t end_x, uint32_t end_y, uint8_t* path )
+{
+    uint64_t cell, result;
+    uint32_t x = end_x;
+    uint32_t y = end_y;
 
-    /* Clear the grid initially. */
-    for ( i = 0; i < result; ++i )
+    if ( !mazelib_check_component_parameters ( width, height, grid, distances ) || path == NULL )
+    {
+        return 0;
+    }
+    if ( end_x >= width || end_y >= height )
+    {
+        return 0;
+    }
+    cell = mazelib_get_cell_index ( end_x, end_y, height );
+    if ( distances[cell] == mazelib_unreachable )
+    {
+        return 0;
+    }
+
+    result = ( uint64_t ) distances[cell] + 1;
+    path[cell >> 3] |= ( uint8_t ) ( 1 << ( cell & 7 ) );
+    while ( distances[cell] )
+    {
+        uint8_t d;
+        uint64_t neighbor = cell;
+
+        /* Moves follow the bits of the cell being left, so step back to a neighbor whose bit leads here. */
+        for ( d = 0; d < 4; ++d )
+        {
+            if ( mazelib_get_neighbor ( width, height, cell, x, y, d, &neighbor ) && distances[neighbor] == distances[cell] - 1 && ( grid[neighbor] & ( 1 << ( d ^ 1 ) ) ) )
+            {
+                break;
+            }
+        }
+        if ( d == 4 )
+        {
+            return 0;    /* The distances do not belong to this maze. */
+        }
+        cell = neighbor;
+        x = ( uint32_t ) ( cell / height );
+        y = ( uint32_t ) ( cell % height );
+        path[cell >> 3] |= ( uint8_t ) ( 1 << ( cell & 7 ) );
+    }
+    return result;
+}
+
+uint64_t mazelib_label_component_band ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t first_column, uint32_t column_count, uint32_t* labels )
+{
+    uint64_t components = 0;
+    uint32_t cell, x, y;
+
+    if ( !mazelib_check_component_parameters ( width, height, grid, labels ) )
+    {
+        return 0;
+    }
+    if ( column_count == 0 || first_column >= width || column_count > width - first_column )
+    {
+        return 0;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "components" );
+
+    /*
+    * A cell which is open to the north simply joins the component of that cell, which is the common case in a run of open cells.
+    * Only passages to the west can join two existing components.
+    */
+    cell = first_column * height;
+    for ( x = first_column; x < first_column + column_count; ++x )
+    {
+        for ( y = 0; y < height; ++y, ++cell )
+        {
+            if ( y > 0 && ( grid[cell] & mazelib_north ) && ( grid[cell - 1] & mazelib_south ) )
+            {
+                labels[cell] = mazelib_find_component ( labels, cell - 1 );
+            }
+            else
+            {
+                labels[cell] = cell;
+                ++components;
+            }
+            if ( x > first_column && ( grid[cell] & mazelib_west ) && ( grid[cell - height] & mazelib_east ) )
+            {
+                components -= mazelib_join_components ( labels, cell, cell - height );
+            }
+        }
+    }
+
+    MAZELIB_TRACE_END ( "components" );
+    return components;
+}
+
+uint64_t mazelib_merge_component_bands ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t band_width, uint32_t* labels, uint32_t* sizes )
+{
+    uint32_t components = 0;
+    uint32_t cell, x, y;
+    uint64_t area;
+
+    if ( !mazelib_check_component_parameters ( width, height, grid, labels ) )
+    {
+        return 0;
+    }
+    if ( band_width == 0 )
+    {
+        return 0;
+    }
+
+    MAZELIB_TRACE_BEGIN ( "components" );
+
+    for ( x = band_width; x < width; x += band_width )
+    {
+        cell = x * height;
+        for ( y = 0; y < height; ++y, ++cell )
+        {
+            if ( ( grid[cell] & mazelib_west ) && ( grid[cell - height] & mazelib_east ) )
+            {
+                mazelib_join_components ( labels, cell, cell - height );
+            }
+        }
+        if ( x > width - band_width )
+        {
+            break;    /* This was the last band, and adding band_width again could overflow. */
+        }
+    }
+
+    /*
+    * Every parent has a lower index than its children, so by the time a cell is reached its parent already holds the final label of their component.
+    * Roots are the first cells of their components, which numbers the components in order of their first cell.
+    */
+    area = width;
+    area *= height;
+    for ( cell = 0; cell < area; ++cell )
+    {
+        const uint32_t parent = labels[cell];
+        if ( parent == cell )
+        {
+            if ( sizes != NULL )
+            {
+                sizes[components] = 0;
+            }
+            labels[cell] = components++;
+        }
+        else
+        {
+            labels[cell] = labels[parent];
+        }
+        if ( sizes != NULL )
+        {
+            ++sizes[labels[cell]];
+        }
+    }
+
+    MAZELIB_TRACE_END ( "components" );
+    return components;
+}
+
+uint64_t mazelib_label_components ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t* labels, uint32_t* sizes )
+{
+    if ( mazelib_label_component_band ( width, height, grid, 0, width, labels ) == 0 )
+    {
+        return 0;
+    }
+    return mazelib_merge_component_bands ( width, height, grid, width, labels, sizes );
+}
+
+/* Return the cell behind the passage in the given direction from cell x, y, or mazelib_unreachable if the passage is not open on both sides. */
+static uint32_t mazelib_get_open_neighbor ( uint32_t width, uint32_t height, const uint8_t* grid, uint32_t cell, uint32_t x, uint32_t y, uint8_t direction )
+{
+    uint32_t neighbor;
+    uint8_t opposite_direction;
+
+    if ( ( grid[cell] & direction ) == 0 )
+    {
+        return mazelib_unreachable;
+    }
+    switch ( direction )
+    {
+        case mazelib_west:
+            if ( x == 0 )
+            {
+                return mazelib_unreachable;
+            }
+            neighbor = cell - height;
+            opposite_direction = mazelib_east;
+            break;
+        case mazelib_east:
+            if ( x == width - 1 )
+            {
+                return mazelib_unreachable;
+            }
+            neighbor = cell + height;
+            opposite_direction = mazelib_west;
+            break;
+        case mazelib_north:
+            if ( y == 0 )
+            {
+                return mazelib_unreachable;
+            }
+            neighbor = cell - 1;
+            opposite_direction = mazelib_south;
+            break;
+        default: /* South */
+            if ( y == height - 1 )
+            {
+                return mazelib_unreachable;
+            }
+            neighbor = cell + 1;
+            opposite_direction = mazelib_north;
+            break;
+    };
+    return ( grid[neighbor] & opposite_direction ) ? neighbor : mazelib_unreachable;
+}
+
+uint64_t mazelib_get_tree_betweenness ( uint32_t width, uint32_t height, const uint8_t* grid, uint64_t* passages, uint64_t* cells, uint32_t* scratch )
+{
+    uint32_t* order;
+    uint32_t* parents;
+    uint32_t* sizes;
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    uint32_t area, i;
+    uint8_t d;
+
+    if ( !mazelib_check_component_parameters ( width, height, grid, scratch ) )
+    {
+        return 0;
+    }
+    area = width * height;
+    order = scratch;
+    parents = scratch + area;
+    sizes = scratch + ( uint64_t ) area * 2;
+
+    /*
+    * Root the tree at the first cell with a breadth first search. Reaching a cell twice means there is a loop.
+    * The breadth first order lists every cell after its parent, so walking it backwards visits every subtree before its root.
+    */
+    for ( i = 0; i < area; ++i )
+    {
+        parents[i] = mazelib_unreachable;
+    }
+    order[tail++] = 0;
+    parents[0] = 0;
+    while ( head < tail )
+    {
+        const uint32_t cell = order[head++];
+        const uint32_t x = cell / height;
+        const uint32_t y = cell % height;
+        for ( d = 0; d < 4; ++d )
+        {
+            const uint32_t neighbor = mazelib_get_open_neighbor ( width, height, grid, cell, x, y, ( uint8_t ) ( 1 << d ) );
+            if ( neighbor == mazelib_unreachable || ( neighbor == parents[cell] && cell != 0 ) )
+            {
+                continue;
+            }
+            if ( parents[neighbor] != mazelib_unreachable )
+            {
+                return 0;
+            }
+            parents[neighbor] = cell;
+            order[tail++] = neighbor;
+        }
+    }
+    if ( tail != area )
+    {
+        return 0;
+    }
+
+    if ( passages != NULL )
     {
-        grid[i] = 0;
+        mazelib_get_kernels ()->fill ( ( uint8_t* ) passages, 0, ( uint64_t ) area * 2 * sizeof ( uint64_t ) );
+    }
+    for ( i = 0; i < area; ++i )
+    {
+        sizes[i] = 1;
+    }
+    if ( cells != NULL )
+    {
+        mazelib_get_kernels ()->fill ( ( uint8_t* ) cells, 0, ( uint64_t ) area * sizeof ( uint64_t ) );
     }
 
-    /* Start by inserting a random cell. */
-    temp = mazelib_get_cell_index ( ( uint32_t ) mazelib_prng_next_in_range ( prng, width ), ( uint32_t ) mazelib_prng_next_in_range ( prng, height ), height );
-    mazelib_assign_cell ( cells, cell_bytes, 0, temp );
-
-    while ( cells_size )
+    /*
+    * Removing a passage splits the maze into the subtree below it and everything else, so its betweenness is the product of the two sizes.
+    * Removing a cell splits it into the subtrees of its children and the rest of the maze, and the pairs through the cell are
+    * all the pairs of the other cells minus those within one of the parts. cells collects the sums of the squared sizes of the children first.
+    */
+    for ( i = area; i-- > 1; )
     {
-        uint32_t x, y, new_x, new_y;
-        uint64_t new_cell_index, current_cell;
-        uint64_t cell_index = 0;
-        uint8_t found_new_neighbor = 0;
-        uint8_t opposite_direction = 0;
+        const uint32_t cell = order[i];
+        const uint32_t parent = parents[cell];
+        const uint64_t below = sizes[cell];
+        const uint64_t product = below * ( area - below );
 
-        if ( cells_size > 1 )
+        sizes[parent] += sizes[cell];
+        if ( cells != NULL )
         {
-            cell_index = cell_selection_callback ( cells_size, prng, user );
-            if ( cell_index >= cells_size )
-            {
-                return 0;    /* The callback returned a value outside the allowed range, so we abort. */
-            }
+            cells[parent] += below * below;
         }
-
-        switch ( cell_bytes )
+        if ( passages != NULL )
         {
-            case 1:
+            if ( parent + height == cell )
             {
-                current_cell = cells[cell_index];
+                passages[( uint64_t ) parent * 2] = product;
             }
-            break;
-            case 2:
+            else if ( parent + 1 == cell )
             {
-                uint16_t* cell_ptr = ( uint16_t* ) cells;
-                current_cell = cell_ptr[cell_index];
+                passages[( uint64_t ) parent * 2 + 1] = product;
             }
-            break;
-            case 4:
+            else if ( cell + height == parent )
             {
-                uint32_t* cell_ptr = ( uint32_t* ) cells;
-                current_cell = cell_ptr[cell_index];
+                passages[( uint64_t ) cell * 2] = product;
             }
-            break;
-            default:
+            else
             {
-                uint64_t* cell_ptr = ( uint64_t* ) cells;
-                current_cell = cell_ptr[cell_index];
+                passages[( uint64_t ) cell * 2 + 1] = product;
             }
-            break;
-        };
+        }
+    }
+    if ( cells != NULL )
+    {
+        const uint64_t others = area - 1;
+        for ( i = 0; i < area; ++i )
+        {
+            const uint64_t above = area - sizes[i];
+            cells[i] = ( others * others - cells[i] - above * above ) / 2;
+        }
+    }
+    return area;
+}
 
-        x = ( uint32_t ) ( current_cell / height );
-        y = ( uint32_t ) ( current_cell % height );
+/* The number of directions tried so far is kept in the low bits of articulation_points while a cell is on the stack. */
+#define mazelib_chokepoint_flag 0x80
 
-        /* Shuffle the directions. */
-        for ( i = 3; i; --i )
+uint64_t mazelib_get_chokepoints ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* articulation_points, uint8_t* bridges, uint32_t* scratch )
+{
+    uint32_t* discovered;
+    uint32_t* low;
+    uint32_t* stack;
+    uint32_t area, root, i;
+    uint32_t time = 0;
+
+    if ( !mazelib_check_component_parameters ( width, height, grid, scratch ) )
+    {
+        return 0;
+    }
+    if ( articulation_points == NULL || bridges == NULL )
+    {
+        return 0;
+    }
+    area = width * height;
+    discovered = scratch;
+    low = scratch + area;
+    stack = scratch + ( uint64_t ) area * 2;
+
+    for ( i = 0; i < area; ++i )
+    {
+        discovered[i] = mazelib_unreachable;
+    }
+    mazelib_get_kernels ()->fill ( articulation_points, 0, area );
+    mazelib_get_kernels ()->fill ( bridges, 0, area );
+
+    for ( root = 0; root < area; ++root )
+    {
+        uint32_t stack_size = 0;
+        uint32_t root_children = 0;
+
+        if ( discovered[root] != mazelib_unreachable )
         {
-            uint8_t swap_index = ( uint8_t ) mazelib_prng_next_in_range ( prng, i + 1 );
-            temp = directions[i];
-            directions[i] = directions[swap_index];
-            directions[swap_index] = temp;
+            continue;
         }
+        discovered[root] = low[root] = time++;
+        stack[stack_size++] = root;
 
-        for ( i = 0; i < 4; ++i )
+        while ( stack_size )
         {
-            switch ( directions[i] )
+            const uint32_t cell = stack[stack_size - 1];
+            const uint32_t x = cell / height;
+            const uint32_t y = cell % height;
+            uint8_t descended = 0;
+
+            /* Carry on with the directions of the cell on top of the stack, until one of them leads to a new cell. */
+            while ( ( articulation_points[cell] & 7 ) < 4 )
             {
-                case mazelib_west:
-                    if ( x == 0 )
-                    {
-                        continue;
-                    }
-                    new_x = x - 1;
-                    new_y = y;
-                    opposite_direction = mazelib_east;
-                    break;
-                case mazelib_east:
-                    if ( x == width - 1 )
-                    {
-                        continue;
-                    }
-                    new_x = x + 1;
-                    new_y = y;
-                    opposite_direction = mazelib_west;
-                    break;
-                case mazelib_north:
-                    if ( y == 0 )
-                    {
-                        continue;
-                    }
-                    new_x = x;
-                    new_y = y - 1;
-                    opposite_direction = mazelib_south;
-                    break;
-                default: /* South */
-                    if ( y == height - 1 )
-                    {
-                        continue;
-                    }
-                    new_x = x;
-                    new_y = y + 1;
-                    opposite_direction = mazelib_north;
-                    break;
-            };
-            new_cell_index = mazelib_get_cell_index ( new_x, new_y, height );
-            assert ( new_cell_index < ( width * height ) );
+                const uint8_t d = articulation_points[cell]++ & 7;
+                const uint32_t neighbor = mazelib_get_open_neighbor ( width, height, grid, cell, x, y, ( uint8_t ) ( 1 << d ) );
 
-            /* If we have already visited the given cell, we don't consider it again. */
-            if ( grid[new_cell_index] )
+                /* The passage back to the parent is not a way around it. */
+                if ( neighbor == mazelib_unreachable || ( stack_size > 1 && neighbor == stack[stack_size - 2] ) )
+                {
+                    continue;
+                }
+                if ( discovered[neighbor] == mazelib_unreachable )
+                {
+                    discovered[neighbor] = low[neighbor] = time++;
+                    stack[stack_size++] = neighbor;
+                    root_children += cell == root;
+                    descended = 1;
+                    break;
+                }
+                if ( discovered[neighbor] < low[cell] )
+                {
+                    low[cell] = discovered[neighbor];
+                }
+            }
+            if ( descended )
             {
                 continue;
             }
 
-            found_new_neighbor = 1;
-
-            /* Carve a two way path between the current and the new cell. */
-            grid[current_cell] |= directions[i];
-            grid[new_cell_index] |= opposite_direction;
-
-            /* Add the new cell to our list. */
-            switch ( cell_bytes )
+            /*
+            * All directions of this cell are done. If nothing below it reaches above its parent, the passage to the parent is a bridge,
+            * and if nothing below it reaches above the parent either, the parent separates it from the rest (unless the parent is the root).
+            */
+            --stack_size;
+            if ( stack_size )
             {
-                case 1:
-                    cells[cells_size] = ( uint8_t ) new_cell_index;
-                    break;
-                case 2:
+                const uint32_t parent = stack[stack_size - 1];
+                if ( low[cell] < low[parent] )
                 {
-                    uint16_t* cell_ptr = ( uint16_t* ) cells;
-                    cell_ptr[cells_size] = ( uint16_t ) new_cell_index;
+                    low[parent] = low[cell];
                 }
-                break;
-                case 4:
+                if ( low[cell] > discovered[parent] )
                 {
-                    uint32_t* cell_ptr = ( uint32_t* ) cells;
-                    cell_ptr[cells_size] = ( uint32_t ) new_cell_index;
+                    if ( parent + height == cell )
+                    {
+                        bridges[parent] |= mazelib_east;
+                        bridges[cell] |= mazelib_west;
+                    }
+                    else if ( cell + height == parent )
+                    {
+                        bridges[parent] |= mazelib_west;
+                        bridges[cell] |= mazelib_east;
+                    }
+                    else if ( parent + 1 == cell )
+                    {
+                        bridges[parent] |= mazelib_south;
+                        bridges[cell] |= mazelib_north;
+                    }
+                    else
+                    {
+                        bridges[parent] |= mazelib_north;
+                        bridges[cell] |= mazelib_south;
+                    }
                 }
-                break;
-                default:
+                if ( parent != root && low[cell] >= discovered[parent] )
                 {
-                    uint64_t* cell_ptr = ( uint64_t* ) cells;
-                    cell_ptr[cells_size] = new_cell_index;
+                    articulation_points[parent] |= mazelib_chokepoint_flag;
                 }
-            };
-
-            ++cells_size;
-            break;
+            }
         }
-        if ( found_new_neighbor == 0 )
+        if ( root_children > 1 )
         {
-
-            /* The current cell has no unvisited neighbors, so we remove it from our list. */
-            if ( cell_index < cells_size - 1 )
-            {
-                memmove ( ( void* ) &cells[cell_index * cell_bytes], ( void* ) &cells[ ( cell_index + 1 ) *cell_bytes], ( cells_size - ( cell_index + 1 ) ) *cell_bytes );
-            }
-            --cells_size;
+            articulation_points[root] |= mazelib_chokepoint_flag;
         }
     }
 
-    if ( blockwise )
+    for ( i = 0; i < area; ++i )
     {
-        uint32_t old_x, old_y, new_x, new_y;
-        uint64_t new_width = width;
-        uint64_t new_height = height;
-        new_width *= 2;
-        new_height *= 2;
-        ++new_width;
-        ++new_height;
-        result = ( new_width * new_height );
+        articulation_points[i] = ( uint8_t ) ( articulation_points[i] >> 7 );
+    }
+    return area;
+}
+
+/* The new direction bits for each transform, indexed by the old ones. */
+static const uint8_t mazelib_transform_directions[8][16] =
+{
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 }, /* Identity */
+    {  0,  4,  8, 12,  2,  6, 10, 14,  1,  5,  9, 13,  3,  7, 11, 15 }, /* Rotate 90 */
+    {  0,  2,  1,  3,  8, 10,  9, 11,  4,  6,  5,  7, 12, 14, 13, 15 }, /* Rotate 180 */
+    {  0,  8,  4, 12,  1,  9,  5, 13,  2, 10,  6, 14,  3, 11,  7, 15 }, /* Rotate 270 */
+    {  0,  2,  1,  3,  4,  6,  5,  7,  8, 10,  9, 11, 12, 14, 13, 15 }, /* Mirror x */
+    {  0,  1,  2,  3,  8,  9, 10, 11,  4,  5,  6,  7, 12, 13, 14, 15 }, /* Mirror y */
+    {  0,  4,  8, 12,  1,  5,  9, 13,  2,  6, 10, 14,  3,  7, 11, 15 }, /* Transpose */
+    {  0,  8,  4, 12,  2, 10,  6, 14,  1,  9,  5, 13,  3, 11,  7, 15 }  /* Anti transpose */
+};
+
+/*
+* Which way each transform reads the original maze.
+* A transform that swaps the axes turns each column of the original into a row of the output,
+* and flips_x and flips_y always refer to the x and y of the original.
+*/
+#define mazelib_transform_swaps_axes(transform) ( ( transform ) == mazelib_transform_rotate_90 || ( transform ) == mazelib_transform_rotate_270 || ( transform ) >= mazelib_transform_transpose )
+#define mazelib_transform_flips_x(transform) ( ( transform ) == mazelib_transform_rotate_180 || ( transform ) == mazelib_transform_rotate_270 || ( transform ) == mazelib_transform_mirror_x || ( transform ) == mazelib_transform_anti_transpose )
+#define mazelib_transform_flips_y(transform) ( ( transform ) == mazelib_transform_rotate_90 || ( transform ) == mazelib_transform_rotate_180 || ( transform ) == mazelib_transform_mirror_y || ( transform ) == mazelib_transform_anti_transpose )
+
+uint64_t mazelib_transform ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t transform, uint8_t* output, uint64_t output_size )
+{
+    const mazelib_kernels* kernels = mazelib_get_kernels ();
+    const uint8_t* table;
+    uint64_t area;
+    uint8_t flip_x, flip_y;
+    uint32_t x, y;
+
+    if ( grid == NULL || output == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 || transform > mazelib_transform_anti_transpose )
+    {
+        return 0;
+    }
+    area = width;
+    area *= height;
+    if ( output_size < area )
+    {
+        return 0;
+    }
+
+    table = mazelib_transform_directions[transform];
+    flip_x = mazelib_transform_flips_x ( transform );
+    flip_y = mazelib_transform_flips_y ( transform );
 
-        for ( i = 0; i < result; ++i )
+    if ( !mazelib_transform_swaps_axes ( transform ) )
+    {
+
+        /* Every column of the output is a column of the original, possibly read backwards. */
+        for ( x = 0; x < width; ++x )
         {
-            output[i] = 1;
+            const uint32_t source_x = flip_x ? width - 1 - x : x;
+            kernels->remap ( grid + ( uint64_t ) source_x * height, height, table, flip_y, output + ( uint64_t ) x * height );
         }
+        return area;
+    }
 
-        for ( old_x = 0, new_x = 1; old_x < width; ++old_x, new_x += 2 )
+    /*
+    * The output is width cells tall and height cells wide, and is produced in tiles of 16 by 16 cells so that both the reads and the writes stay within a few cache lines.
+    * Column x of the original becomes row x of the output (or row width - 1 - x if flip_x is set), and row y becomes column y (or height - 1 - y if flip_y is set),
+    * so the flips only change where each tile is read from and which way the strides run.
+    */
+    for ( y = 0; y < height; y += 16 )
+    {
+        const uint32_t tile_width = height - y < 16 ? height - y : 16;
+        const ptrdiff_t output_stride = flip_y ? - ( ptrdiff_t ) width : ( ptrdiff_t ) width;
+        uint8_t* output_column = output + ( uint64_t ) ( flip_y ? height - 1 - y : y ) * width;
+        for ( x = 0; x < width; x += 16 )
         {
-            for ( old_y = 0, new_y = 1; old_y < height; ++old_y, new_y += 2 )
+            const uint32_t tile_height = width - x < 16 ? width - x : 16;
+            const ptrdiff_t input_stride = flip_x ? - ( ptrdiff_t ) height : ( ptrdiff_t ) height;
+            const uint8_t* input = grid + ( uint64_t ) ( flip_x ? width - 1 - x : x ) * height + y;
+            uint32_t i, j;
+
+            if ( tile_width == 16 && tile_height == 16 )
             {
-                uint64_t old_cell_index = mazelib_get_cell_index ( old_x, old_y, height );
-                uint64_t new_cell_index = mazelib_get_cell_index ( new_x, new_y, new_height );
-                assert ( new_cell_index < result );
-                assert ( new_x != new_width - 1 );
-                assert ( new_y != new_height - 1 );
-                output[new_cell_index] = 0;
-                if ( ( grid[old_cell_index]&mazelib_south ) )
-                {
-                    assert ( new_y + 1 != new_height - 1 );
-                    new_cell_index = mazelib_get_cell_index ( new_x, new_y + 1, new_height );
-                    assert ( new_cell_index < result );
-                    output[new_cell_index] = 0;
-                }
-                if ( ( grid[old_cell_index]&mazelib_east ) )
+                kernels->transpose_tile ( input, input_stride, table, output_column + x, output_stride );
+                continue;
+            }
+            for ( j = 0; j < tile_width; ++j )
+            {
+                for ( i = 0; i < tile_height; ++i )
                 {
-                    assert ( new_x + 1 != new_width - 1 );
-                    new_cell_index = mazelib_get_cell_index ( new_x + 1, new_y, new_height );
-                    assert ( new_cell_index < result );
-                    output[new_cell_index] = 0;
+                    const uint8_t value = input[( ptrdiff_t ) i * input_stride + j];
+                    output_column[( ptrdiff_t ) j * output_stride + x + i] = ( uint8_t ) ( table[value & 15] | ( value & 0xf0 ) );
                 }
             }
         }
-
     }
-
-    return result;
+    return area;
 }
 
-static uint64_t mazelib_high_level_cell_selection_callback ( uint64_t count, mazelib_prng* prng, void* user )
+static uint64_t mazelib_fnv1a ( uint64_t hash, uint64_t value, uint8_t bytes )
 {
-    int8_t* random_threshold_percent = ( int8_t* ) user;
-    if ( *random_threshold_percent > 0 && ( int8_t ) mazelib_prng_next_in_range ( prng, 101 ) < *random_threshold_percent )
+    uint8_t i;
+    for ( i = 0; i < bytes; ++i )
     {
-        return mazelib_prng_next_in_range ( prng, count );
+        hash ^= ( value >> ( i * 8 ) ) & 0xff;
+        hash *= 0x100000001b3;
     }
-    return count - 1;
+    return hash;
 }
 
-uint64_t mazelib_generate ( uint32_t width, uint32_t height, uint64_t random_seed, int8_t random_threshold_percent, uint8_t blockwise, uint8_t* output, uint64_t output_size )
+uint64_t mazelib_get_canonical_hash ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* transform )
 {
-    mazelib_prng prng;
+    uint8_t candidates[8];
+    const uint8_t* cursors[8];
+    ptrdiff_t steps[8];
+    ptrdiff_t column_steps[8];
+    uint8_t candidate_count = 0;
+    uint8_t i, t;
+    uint32_t x, y;
+    uint32_t output_width, output_height;
+    uint64_t hash = 0xcbf29ce484222325;
 
-    mazelib_prng_seed ( &prng, random_seed );
+    if ( grid == NULL )
+    {
+        return 0;
+    }
+    if ( width == 0 || height == 0 )
+    {
+        return 0;
+    }
+    output_width = width < height ? width : height;
+    output_height = width < height ? height : width;
 
-    if ( random_threshold_percent < 0 )
+    /*
+    * A maze and its quarter turn can only be compared when they have the same shape.
+    * Each candidate walks the original maze with a cursor, which moves by steps to the next cell in a column of the transformed maze
+    * and by column_steps from the end of one column to the start of the next.
+    */
+    for ( t = 0; t < 8; ++t )
     {
-        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+        ptrdiff_t step, column_step;
+        uint32_t origin_x = mazelib_transform_flips_x ( t ) ? width - 1 : 0;
+        uint32_t origin_y = mazelib_transform_flips_y ( t ) ? height - 1 : 0;
+        if ( width != height && ( width < height ) == mazelib_transform_swaps_axes ( t ) )
+        {
+            continue;
+        }
+        if ( mazelib_transform_swaps_axes ( t ) )
+        {
+            step = mazelib_transform_flips_x ( t ) ? - ( ptrdiff_t ) height : ( ptrdiff_t ) height;
+            column_step = mazelib_transform_flips_y ( t ) ? -1 : 1;
+        }
+        else
+        {
+            step = mazelib_transform_flips_y ( t ) ? -1 : 1;
+            column_step = mazelib_transform_flips_x ( t ) ? - ( ptrdiff_t ) height : ( ptrdiff_t ) height;
+        }
+        candidates[candidate_count] = t;
+        cursors[candidate_count] = grid + mazelib_get_cell_index ( origin_x, origin_y, height );
+        steps[candidate_count] = step;
+        column_steps[candidate_count] = column_step - step * ( ptrdiff_t ) output_height;
+        ++candidate_count;
     }
-    else if ( random_threshold_percent > 100 )
+    hash = mazelib_fnv1a ( hash, output_width, 4 );
+    hash = mazelib_fnv1a ( hash, output_height, 4 );
+
+    for ( x = 0; x < output_width; ++x )
     {
-        random_threshold_percent = 100;
+        for ( y = 0; y < output_height; ++y )
+        {
+            uint8_t values[8];
+            uint8_t smallest = 0xff;
+            uint8_t remaining = 0;
+
+            if ( candidate_count == 1 )
+            {
+                break;
+            }
+
+            /* All remaining candidates agree on every cell so far, so only those with the smallest value at this cell can lead to the smallest maze. */
+            for ( i = 0; i < candidate_count; ++i )
+            {
+                const uint8_t value = *cursors[i];
+                values[i] = ( uint8_t ) ( mazelib_transform_directions[candidates[i]][value & 15] | ( value & 0xf0 ) );
+                if ( values[i] < smallest )
+                {
+                    smallest = values[i];
+                }
+                cursors[i] += steps[i];
+            }
+            for ( i = 0; i < candidate_count; ++i )
+            {
+                if ( values[i] == smallest )
+                {
+                    candidates[remaining] = candidates[i];
+                    cursors[remaining] = cursors[i];
+                    steps[remaining] = steps[i];
+                    column_steps[remaining] = column_steps[i];
+                    ++remaining;
+                }
+            }
+            candidate_count = remaining;
+            hash = mazelib_fnv1a ( hash, smallest, 1 );
+        }
+
+        /* Once a single candidate is left, the rest of it is hashed without any comparisons. */
+        if ( candidate_count == 1 )
+        {
+            const uint8_t* table = mazelib_transform_directions[candidates[0]];
+            const uint8_t* cursor = cursors[0];
+            for ( ; y < output_height; ++y )
+            {
+                hash = mazelib_fnv1a ( hash, table[*cursor & 15] | ( *cursor & 0xf0 ), 1 );
+                cursor += steps[0];
+            }
+            cursors[0] = cursor;
+        }
+        for ( i = 0; i < candidate_count; ++i )
+        {
+            cursors[i] += column_steps[i];
+        }
     }
 
-    return mazelib_generate_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, blockwise, output, output_size );
+    /* Candidates that are still tied produce the same maze, so the first one is reported. */
+    if ( transform != NULL )
+    {
+        *transform = candidates[0];
+    }
+    return hash;
 }
 
 #endif /* MAZELIB_IMPLEMENTATION */
@@ -670,6 +4551,32 @@ uint64_t mazelib_generate ( uint32_t width, uint32_t height, uint64_t random_see
 *
 * Version 1.0 - 2021-02-18
 * Initial release.
+*
+* Version 1.1 - In development
+* Added runtime CPU dispatch to SSE2, AVX2 and AVX-512 kernels for the blockwise conversion.
+* Added mazelib_convert_to_blockwise.
+* The order in which the coordinates of the first cell are drawn is now fixed instead of being left to the compiler.
+* Added mazelib.hpp, a header only C++17 interface.
+* mazelib.hpp can generate mazes at compile time when compiled as C++20.
+* mazelib.hpp can generate mazes one passage at a time through a C++20 coroutine.
+* Added mazelib_get_distances.
+* Added allocator aware owning types for mazes, distance maps and solver scratch to mazelib.hpp, with aliases for std::pmr.
+* Added the MAZELIB_STATS build mode, which counts steps, removals, moved bytes, random numbers and the size of the list while generating.
+* Added the MAZELIB_TRACE_BEGIN and MAZELIB_TRACE_END hooks around each phase of the work.
+* Added mazelib_convert_columns_to_blockwise, which converts a band of columns so that large mazes can be converted by several threads.
+* Added mazelib_get_memory_report and mazelib_generate_extended_with_report, which break down the memory used for generation.
+* Added mazelib_generate_symmetric and mazelib_generate_symmetric_extended, which generate mirrored or rotationally symmetric mazes.
+* Added mazelib_transform and mazelib_get_canonical_hash, which rotate and mirror mazes and recognize mazes that are rotations or reflections of each other.
+* Added mazelib_label_components, along with mazelib_label_component_band and mazelib_merge_component_bands for labelling large mazes on several threads.
+* Added mazelib_get_tree_betweenness and mazelib_get_chokepoints, which find the passages and cells that carry the most traffic or would cut a maze in two.
+* Added mazelib_generate_with_waypoints and mazelib_generate_with_waypoints_extended, which generate mazes whose solution passes through given cells in order.
+* Added mazelib_complete and mazelib_complete_extended, which turn a partially carved maze with locked walls into a perfect maze.
+* Added mazelib_build_tile_library and mazelib_generate_tiled, which fill large mazes by copying tiles from a library of small ones.
+* Added mazelib_generate_recorded, which logs every passage in about a byte each along with the order in which cells were reached, and mazelib_replay_seek, which replays such a log to any step.
+* Added mazelib_convert_to_blockwise_with_path and mazelib_convert_columns_to_blockwise_with_path, which draw a path while converting, and mazelib_mark_path to find one.
+* Grids of MAZELIB_STREAMING_THRESHOLD bytes and more are cleared with non-temporal stores. Added mazelib_advise_huge_pages.
+* Added mazelib_generate_with_frontier, whose cell selection callback gets a read-only view of the list of cells and the grid.
+* Added Python bindings (python/mazelibmodule.c), which expose mazes and analysis results through the buffer protocol and release the interpreter lock while working.
 */
 
 /* LICENSE
@@ -0,0 +1,1249 @@
+/* Maze Generation Library - C++ interface
+* Mazelib version 1.1
+*
+* See the end of mazelib.h for licensing terms, references and further reading.
+*
+* This header is a thin C++17 layer on top of the low level API of mazelib.
+*
+* In C, the cell selection callback is a function pointer which receives a void pointer, so the compiler can never inline it into the generation loop.
+* Here the policy is a functor which is passed as a template parameter instead, and the generation loop is a template as well.
+* The compiler is therefore free to inline both the policy and the random number generator into a specialized copy of the loop.
+* Given the same prng state and an equivalent policy, the output is byte for byte identical to that of mazelib_generate_extended.
+*
+* USAGE
+*
+* The C library still has to be compiled in exactly one translation unit, as described in mazelib.h.
+* You can then include mazelib.hpp wherever you need it. For example:
+*
+* mazelib_prng prng;
+* mazelib::seed ( prng, 1234 );
+* mazelib::workspace<mazelib::blockwise> maze ( 30, 10 );
+* if ( maze.generate ( prng, mazelib::threshold ( 25, prng ) ) )
+* {
+*     bool wall = maze.view ().is_wall ( 0, 0 );
+* }
+*
+* The same result can be written to a buffer of your own with mazelib::generate<mazelib::threshold, mazelib::blockwise> ( buffer, 30, 10, prng, policy ).
+* Such a buffer has exactly the layout and size of the one used by mazelib_generate_extended, see mazelib::required_buffer_size.
+*
+* POLICIES
+*
+* A policy is any copyable object that can be called as policy ( count, prng ), where count is a uint64_t and prng is a mazelib_prng reference.
+* Like the C callback, it should return a value between 0 and count (exclusive), and if it does not, generation is aborted and 0 is returned.
+* The policies newest, random and threshold are provided, and threshold behaves exactly like the high level API.
+*
+* COMPILE TIME GENERATION
+*
+* When compiled as C++20, mazelib::make_maze generates a maze of a fixed size into a std::array in a constant expression,
+* so small mazes can be embedded in a program without any work at startup. See make_maze below.
+*
+* STEP BY STEP GENERATION
+*
+* When compiled as C++20 with coroutine support, mazelib::carve_steps returns a lazy sequence of carve events.
+* Every time an event is requested, the generator runs just far enough to carve one more passage. See carve_steps below.
+*
+* OWNING TYPES
+*
+* mazelib::workspace owns a maze along with the storage needed to generate it, while mazelib::distance_map and mazelib::solver_scratch
+* own the results and temporary storage of mazelib_get_distances.
+* All of them take an allocator, and the aliases in mazelib::pmr use std::pmr::polymorphic_allocator so that they can be placed in a std::pmr::memory_resource.
+*
+* FORMATS AND LAYOUTS
+*
+* The Format parameter is either mazelib::compact or mazelib::blockwise.
+* The Layout parameter is the unsigned integer type used for the list of cells while generating.
+* The default, mazelib::auto_layout, picks the smallest type that fits the dimensions, just like the C library does.
+* A fixed type removes a runtime dispatch, at the cost of a buffer which may be larger than the one the C library would have needed.
+*/
+
+#ifndef MAZELIB_HPP
+#define MAZELIB_HPP
+
+#include "mazelib.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<span>) && __cplusplus >= 202002L
+#include <span>
+#endif
+#endif
+
+/*
+* From C++20 onwards the generation loop, the prng and the built in policies are constexpr, so that mazes can be generated at compile time.
+* With older standards they are plain inline functions.
+*/
+#if __cplusplus >= 202002L && defined(__cpp_constexpr) && __cpp_constexpr >= 201907L
+#define MAZELIB_CONSTEXPR constexpr
+#define MAZELIB_HAS_CONSTEXPR_GENERATION 1
+#include <array>
+#else
+#define MAZELIB_CONSTEXPR inline
+#endif
+
+/* The std::pmr aliases need <memory_resource>, which is part of C++17 but missing from some older standard libraries. */
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#if defined(__cpp_lib_memory_resource)
+#define MAZELIB_HAS_MEMORY_RESOURCE 1
+#endif
+#endif
+#endif
+
+/* From C++20 onwards, carve_steps can generate a maze lazily through a coroutine. */
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define MAZELIB_HAS_COROUTINES 1
+#include <coroutine>
+#include <iterator>
+#include <new>
+#endif
+#endif
+
+namespace mazelib
+{
+
+    /* SPANS */
+
+#ifdef __cpp_lib_span
+    template <class T>
+    using span = std::span<T>;
+#else
+
+    /* A minimal stand in for std::span, which is only available from C++20 onwards. */
+    template <class T>
+    class span
+    {
+    public:
+        span () : data_ ( nullptr ), size_ ( 0 ) {}
+
+        span ( T* data, std::size_t size ) : data_ ( data ), size_ ( size ) {}
+
+        /* Construct from any contiguous container with data () and size (), such as std::vector or std::array. */
+        template < class Container, class = typename std::enable_if < std::is_convertible < decltype ( std::declval<Container&> ().data () ), T* >::value >::type >
+        span ( Container& container ) : data_ ( container.data () ), size_ ( container.size () ) {}
+
+        T* data () const
+        {
+            return data_;
+        }
+        std::size_t size () const
+        {
+            return size_;
+        }
+        bool empty () const
+        {
+            return size_ == 0;
+        }
+        T& operator[] ( std::size_t index ) const
+        {
+            return data_[index];
+        }
+        T* begin () const
+        {
+            return data_;
+        }
+        T* end () const
+        {
+            return data_ + size_;
+        }
+
+    private:
+        T* data_;
+        std::size_t size_;
+    };
+
+#endif
+
+    /* DIRECTIONS */
+
+    enum class direction : uint8_t
+    {
+        west = mazelib_west,
+        east = mazelib_east,
+        north = mazelib_north,
+        south = mazelib_south
+    };
+
+    /* A passage which was carved from one cell to a neighboring cell, which was unvisited until then. */
+    struct carve_event
+    {
+        uint64_t cell;
+        uint64_t neighbor;
+        direction towards;
+    };
+
+    /* PRNG */
+
+    /* These mirror mazelib_prng_seed, mazelib_prng_next and mazelib_prng_next_in_range, but are visible to the compiler so that they can be inlined. */
+
+    MAZELIB_CONSTEXPR void seed ( mazelib_prng& prng, uint64_t x )
+    {
+        for ( int i = 0; i < 4; ++i )
+        {
+            uint64_t z = ( x += 0x9e3779b97f4a7c15 );
+            z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9;
+            z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111eb;
+            prng.s[i] = z ^ ( z >> 31 );
+        }
+    }
+
+    MAZELIB_CONSTEXPR uint64_t next ( mazelib_prng& prng )
+    {
+        uint64_t* s = prng.s;
+        const uint64_t result = ( ( ( s[0] + s[3] ) << 23 ) | ( ( s[0] + s[3] ) >> 41 ) ) + s[0];
+        const uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+
+        s[2] ^= t;
+
+        s[3] = ( s[3] << 45 ) | ( s[3] >> 19 );
+
+        return result;
+    }
+
+    MAZELIB_CONSTEXPR uint64_t next_in_range ( mazelib_prng& prng, uint64_t range )
+    {
+        uint64_t x, r;
+        do
+        {
+            x = next ( prng );
+            r = x % range;
+        }
+        while ( x - r > -range );
+        return r;
+    }
+
+    /* POLICIES */
+
+    /* Always select the most recent cell. */
+    struct newest
+    {
+        MAZELIB_CONSTEXPR uint64_t operator() ( uint64_t count, mazelib_prng& ) const
+        {
+            return count - 1;
+        }
+    };
+
+    /* Always select a random cell. */
+    struct random
+    {
+        MAZELIB_CONSTEXPR uint64_t operator() ( uint64_t count, mazelib_prng& prng ) const
+        {
+            return next_in_range ( prng, count );
+        }
+    };
+
+    /* Select a random cell a given percentage of the time, and the most recent one otherwise. This is the policy of the high level API. */
+    struct threshold
+    {
+        /* The percentage is used as is, and should be between 0 and 100. */
+        constexpr explicit threshold ( int8_t percent ) : percent ( percent ) {}
+
+        /*
+        * Resolve the percentage the same way as mazelib_generate does.
+        * Values below 0 are replaced with a random value drawn from prng, and values above 100 are clamped.
+        * Seeding a prng, constructing a threshold from it and generating with it gives the same maze as mazelib_generate with the same seed.
+        */
+        MAZELIB_CONSTEXPR threshold ( int8_t percent, mazelib_prng& prng ) : percent ( percent )
+        {
+            if ( percent < 0 )
+            {
+                this->percent = ( int8_t ) next_in_range ( prng, 101 );
+            }
+            else if ( percent > 100 )
+            {
+                this->percent = 100;
+            }
+        }
+
+        MAZELIB_CONSTEXPR uint64_t operator() ( uint64_t count, mazelib_prng& prng ) const
+        {
+            if ( percent > 0 && ( int8_t ) next_in_range ( prng, 101 ) < percent )
+            {
+                return next_in_range ( prng, count );
+            }
+            return count - 1;
+        }
+
+        int8_t percent;
+    };
+
+    /* VIEWS */
+
+    /* A read only view of a maze in the compact format. */
+    class compact_view
+    {
+    public:
+        compact_view ( span<const uint8_t> cells, uint32_t width, uint32_t height ) : cells_ ( cells ), width_ ( width ), height_ ( height ) {}
+
+        span<const uint8_t> data () const
+        {
+            return cells_;
+        }
+
+        uint32_t width () const
+        {
+            return width_;
+        }
+        uint32_t height () const
+        {
+            return height_;
+        }
+
+        /* Return the direction bitmask of a cell. */
+        uint8_t operator() ( uint32_t x, uint32_t y ) const
+        {
+            return cells_[( std::size_t ) x * height_ + y];
+        }
+
+        /* Return true if it is possible to walk from the given cell in the given direction. */
+        bool can_move ( uint32_t x, uint32_t y, direction to ) const
+        {
+            return ( ( *this ) ( x, y ) & ( uint8_t ) to ) != 0;
+        }
+
+    private:
+        span<const uint8_t> cells_;
+        uint32_t width_;
+        uint32_t height_;
+    };
+
+    /*
+    * A read only view of a maze in the blockwise format.
+    * The width and height given to the constructor are those the maze was generated with.
+    * The view itself is ((width*2)+1) by ((height*2)+1) blocks, which is what width () and height () return.
+    */
+    class blockwise_view
+    {
+    public:
+        blockwise_view ( span<const uint8_t> blocks, uint32_t width, uint32_t height ) : blocks_ ( blocks ), width_ ( ( uint64_t ) width * 2 + 1 ), height_ ( ( uint64_t ) height * 2 + 1 ) {}
+
+        span<const uint8_t> data () const
+        {
+            return blocks_;
+        }
+
+        uint64_t width () const
+        {
+            return width_;
+        }
+        uint64_t height () const
+        {
+            return height_;
+        }
+
+        /* Return the raw value of a block, which is 0 for empty space and 1 for a wall. */
+        uint8_t operator() ( uint64_t x, uint64_t y ) const
+        {
+            return blocks_[( std::size_t ) ( x * height_ + y )];
+        }
+
+        bool is_wall ( uint64_t x, uint64_t y ) const
+        {
+            return ( *this ) ( x, y ) != 0;
+        }
+
+    private:
+        span<const uint8_t> blocks_;
+        uint64_t width_;
+        uint64_t height_;
+    };
+
+    /* FORMATS AND LAYOUTS */
+
+    struct compact
+    {
+        static constexpr bool is_blockwise = false;
+        using view_type = compact_view;
+    };
+
+    struct blockwise
+    {
+        static constexpr bool is_blockwise = true;
+        using view_type = blockwise_view;
+    };
+
+    /* Pick the cell type from the dimensions at runtime, exactly like the C library. */
+    struct auto_layout
+    {
+    };
+
+    namespace detail
+    {
+
+        template <class Layout>
+        struct is_layout : std::integral_constant < bool, std::is_same<Layout, auto_layout>::value || ( std::is_integral<Layout>::value && std::is_unsigned<Layout>::value && !std::is_same<Layout, bool>::value ) >
+        {
+        };
+
+        constexpr uint8_t cell_bytes_for_dimensions ( uint32_t width, uint32_t height )
+        {
+            const uint64_t area = ( uint64_t ) width * height;
+            if ( area < UINT8_MAX )
+            {
+                return 1;
+            }
+            if ( area < UINT16_MAX )
+            {
+                return 2;
+            }
+            if ( area < UINT32_MAX )
+            {
+                return 4;
+            }
+            return 8;
+        }
+
+        /*
+        * Shuffle the directions, then carve a passage from the current cell to the first unvisited neighbor in that order.
+        * The directions are kept between calls, as the C implementation does.
+        * Returns the direction that was carved in, or 0 if the cell has no unvisited neighbors.
+        */
+        MAZELIB_CONSTEXPR uint8_t carve ( uint8_t* grid, uint32_t width, uint32_t height, uint64_t current, uint8_t ( &directions ) [4], mazelib_prng& prng, uint64_t& neighbor )
+        {
+            const uint32_t x = ( uint32_t ) ( current / height );
+            const uint32_t y = ( uint32_t ) ( current % height );
+
+            for ( uint64_t i = 3; i; --i )
+            {
+                std::swap ( directions[i], directions[( uint8_t ) next_in_range ( prng, i + 1 )] );
+            }
+
+            for ( int i = 0; i < 4; ++i )
+            {
+                uint8_t opposite_direction;
+                switch ( directions[i] )
+                {
+                    case mazelib_west:
+                        if ( x == 0 )
+                        {
+                            continue;
+                        }
+                        neighbor = current - height;
+                        opposite_direction = mazelib_east;
+                        break;
+                    case mazelib_east:
+                        if ( x == width - 1 )
+                        {
+                            continue;
+                        }
+                        neighbor = current + height;
+                        opposite_direction = mazelib_west;
+                        break;
+                    case mazelib_north:
+                        if ( y == 0 )
+                        {
+                            continue;
+                        }
+                        neighbor = current - 1;
+                        opposite_direction = mazelib_south;
+                        break;
+                    default: /* South */
+                        if ( y == height - 1 )
+                        {
+                            continue;
+                        }
+                        neighbor = current + 1;
+                        opposite_direction = mazelib_north;
+                        break;
+                }
+                if ( grid[neighbor] )
+                {
+                    continue;
+                }
+                grid[current] |= directions[i];
+                grid[neighbor] |= opposite_direction;
+                return directions[i];
+            }
+            return 0;
+        }
+
+        /* The generation loop of mazelib_generate_extended, specialized for a policy and a cell type. */
+        template <class Policy, class Cell>
+        MAZELIB_CONSTEXPR uint64_t grow ( uint32_t width, uint32_t height, mazelib_prng& prng, Policy& policy, uint8_t* grid, Cell* cells )
+        {
+            const uint64_t area = ( uint64_t ) width * height;
+            uint8_t directions[4] = { mazelib_west, mazelib_east, mazelib_north, mazelib_south };
+            uint64_t count = 1;
+
+            std::fill_n ( grid, area, ( uint8_t ) 0 );
+
+            /* The row is drawn before the column, like in the C implementation. */
+            const uint64_t y = next_in_range ( prng, height );
+            cells[0] = ( Cell ) ( next_in_range ( prng, width ) * height + y );
+
+            while ( count )
+            {
+                uint64_t index = 0;
+                uint64_t neighbor;
+                if ( count > 1 )
+                {
+                    index = policy ( count, prng );
+                    if ( index >= count )
+                    {
+                        return 0;
+                    }
+                }
+                if ( carve ( grid, width, height, cells[index], directions, prng, neighbor ) )
+                {
+                    cells[count++] = ( Cell ) neighbor;
+                }
+                else
+                {
+                    std::copy ( cells + index + 1, cells + count, cells + index );
+                    --count;
+                }
+            }
+            return area;
+        }
+
+        /*
+        * The same algorithm as grow, but suspended after every carved passage so that it can be driven one step at a time.
+        * It draws the same random numbers in the same order as grow, so the finished grid is identical.
+        */
+        template <class Policy, class Cell>
+        class stepper
+        {
+        public:
+            MAZELIB_CONSTEXPR stepper ( uint32_t width, uint32_t height, mazelib_prng& prng, Policy policy, uint8_t* grid, Cell* cells )
+                : width_ ( width ), height_ ( height ), prng_ ( prng ), policy_ ( policy ), grid_ ( grid ), cells_ ( cells ), count_ ( 1 ), failed_ ( false ),
+                  directions_ { mazelib_west, mazelib_east, mazelib_north, mazelib_south }
+            {
+                std::fill_n ( grid, ( uint64_t ) width * height, ( uint8_t ) 0 );
+                const uint64_t y = next_in_range ( prng, height );
+                cells[0] = ( Cell ) ( next_in_range ( prng, width ) * height + y );
+            }
+
+            /* Run until the next passage is carved. Returns false when the maze is complete, or when the policy returned an index out of range. */
+            MAZELIB_CONSTEXPR bool next ( carve_event& event )
+            {
+                while ( count_ )
+                {
+                    uint64_t index = 0;
+                    uint64_t neighbor = 0;
+                    if ( count_ > 1 )
+                    {
+                        index = policy_ ( count_, prng_ );
+                        if ( index >= count_ )
+                        {
+                            failed_ = true;
+                            count_ = 0;
+                            return false;
+                        }
+                    }
+                    const uint64_t cell = cells_[index];
+                    const uint8_t towards = carve ( grid_, width_, height_, cell, directions_, prng_, neighbor );
+                    if ( towards )
+                    {
+                        cells_[count_++] = ( Cell ) neighbor;
+                        event.cell = cell;
+                        event.neighbor = neighbor;
+                        event.towards = ( direction ) towards;
+                        return true;
+                    }
+                    std::copy ( cells_ + index + 1, cells_ + count_, cells_ + index );
+                    --count_;
+                }
+                return false;
+            }
+
+            MAZELIB_CONSTEXPR bool failed () const
+            {
+                return failed_;
+            }
+
+        private:
+            uint32_t width_;
+            uint32_t height_;
+            mazelib_prng& prng_;
+            Policy policy_;
+            uint8_t* grid_;
+            Cell* cells_;
+            uint64_t count_;
+            bool failed_;
+            uint8_t directions_[4];
+        };
+
+        /* A constexpr copy of the portable blockwise conversion in mazelib.h. */
+        MAZELIB_CONSTEXPR void expand_to_blockwise ( uint32_t width, uint32_t height, const uint8_t* grid, uint8_t* output )
+        {
+            const uint64_t new_height = ( uint64_t ) height * 2 + 1;
+            for ( uint64_t y = 0; y < new_height; ++y )
+            {
+                output[y] = 1;
+            }
+            output += new_height;
+            for ( uint32_t x = 0; x < width; ++x, grid += height, output += new_height * 2 )
+            {
+                uint8_t* cells_column = output;
+                uint8_t* walls_column = output + new_height;
+                cells_column[0] = 1;
+                walls_column[0] = 1;
+                for ( uint32_t y = 0; y < height; ++y )
+                {
+                    cells_column[( uint64_t ) y * 2 + 1] = 0;
+                    cells_column[( uint64_t ) y * 2 + 2] = ( uint8_t ) ( ( grid[y] & mazelib_south ) == 0 );
+                    walls_column[( uint64_t ) y * 2 + 1] = ( uint8_t ) ( ( grid[y] & mazelib_east ) == 0 );
+                    walls_column[( uint64_t ) y * 2 + 2] = 1;
+                }
+            }
+        }
+
+        template <uint32_t Width, uint32_t Height>
+        using cell_type_for_dimensions = typename std::conditional < cell_bytes_for_dimensions ( Width, Height ) == 1, uint8_t,
+              typename std::conditional < cell_bytes_for_dimensions ( Width, Height ) == 2, uint16_t,
+              typename std::conditional < cell_bytes_for_dimensions ( Width, Height ) == 4, uint32_t, uint64_t >::type >::type >::type;
+
+        template <class Format, class Cell, class Policy>
+        uint64_t generate_with ( span<uint8_t> output, uint32_t width, uint32_t height, mazelib_prng& prng, Policy& policy, uint64_t required_size )
+        {
+            const uint64_t area = ( uint64_t ) width * height;
+            uint8_t* grid;
+            Cell* cells;
+
+            /* The same layout as in mazelib_generate_extended. */
+            if ( Format::is_blockwise )
+            {
+                grid = output.data () + ( std::size_t ) ( required_size - area );
+                cells = reinterpret_cast<Cell*> ( output.data () );
+            }
+            else
+            {
+                grid = output.data ();
+                cells = reinterpret_cast<Cell*> ( output.data () + ( std::size_t ) area );
+            }
+            if ( grow ( width, height, prng, policy, grid, cells ) == 0 )
+            {
+                return 0;
+            }
+            if ( Format::is_blockwise )
+            {
+                return mazelib_convert_to_blockwise ( width, height, grid, output.data (), required_size - area );
+            }
+            return area;
+        }
+
+    }
+
+    /* Get the required buffer size in bytes for mazelib::generate. With the automatic layout this is the same as mazelib_get_required_buffer_size. */
+    template <class Format, class Layout = auto_layout>
+    uint64_t required_buffer_size ( uint32_t width, uint32_t height )
+    {
+        static_assert ( detail::is_layout<Layout>::value, "Layout must be mazelib::auto_layout or an unsigned integer type" );
+        if constexpr ( std::is_same<Layout, auto_layout>::value )
+        {
+            return mazelib_get_required_buffer_size ( width, height, Format::is_blockwise );
+        }
+        else
+        {
+            if ( width == 0 || height == 0 )
+            {
+                return 0;
+            }
+            const uint64_t area = ( uint64_t ) width * height;
+            if ( Format::is_blockwise )
+            {
+                return area * sizeof ( Layout ) + ( ( uint64_t ) width * 2 + 1 ) * ( ( uint64_t ) height * 2 + 1 );
+            }
+            return area * sizeof ( Layout ) + area;
+        }
+    }
+
+    /* Describe the memory that mazelib::generate will use, see mazelib_get_memory_report. The report is all zeroes if the dimensions are invalid. */
+    template <class Format, class Layout = auto_layout>
+    mazelib_memory_report memory_report ( uint32_t width, uint32_t height )
+    {
+        static_assert ( detail::is_layout<Layout>::value, "Layout must be mazelib::auto_layout or an unsigned integer type" );
+        mazelib_memory_report report {};
+        if ( mazelib_get_memory_report ( width, height, Format::is_blockwise, std::is_same<Layout, auto_layout>::value ? 0 : ( uint8_t ) sizeof ( Layout ), &report ) == 0 )
+        {
+            report = mazelib_memory_report {};
+        }
+        return report;
+    }
+
+    /*
+    * Generate a maze with a policy that is inlined into the generation loop.
+    *
+    * output must hold at least required_buffer_size<Format, Layout> ( width, height ) bytes.
+    * The function returns the number of bytes at the beginning of output that hold the result, or 0 if the parameters were invalid or the policy returned an index out of range.
+    */
+    template <class Policy, class Format = compact, class Layout = auto_layout>
+    uint64_t generate ( span<uint8_t> output, uint32_t width, uint32_t height, mazelib_prng& prng, Policy policy = Policy () )
+    {
+        static_assert ( detail::is_layout<Layout>::value, "Layout must be mazelib::auto_layout or an unsigned integer type" );
+        const uint64_t required_size = required_buffer_size<Format, Layout> ( width, height );
+
+        if ( required_size == 0 || output.data () == nullptr || output.size () < required_size )
+        {
+            return 0;
+        }
+        if constexpr ( std::is_same<Layout, auto_layout>::value )
+        {
+            switch ( detail::cell_bytes_for_dimensions ( width, height ) )
+            {
+                case 1:
+                    return detail::generate_with<Format, uint8_t> ( output, width, height, prng, policy, required_size );
+                case 2:
+                    return detail::generate_with<Format, uint16_t> ( output, width, height, prng, policy, required_size );
+                case 4:
+                    return detail::generate_with<Format, uint32_t> ( output, width, height, prng, policy, required_size );
+                default:
+                    return detail::generate_with<Format, uint64_t> ( output, width, height, prng, policy, required_size );
+            }
+        }
+        else
+        {
+            if ( ( uint64_t ) width * height - 1 > std::numeric_limits<Layout>::max () )
+            {
+                return 0;    /* The cell type is too small to index every cell. */
+            }
+            return detail::generate_with<Format, Layout> ( output, width, height, prng, policy, required_size );
+        }
+    }
+
+#ifdef MAZELIB_HAS_CONSTEXPR_GENERATION
+
+    /* COMPILE TIME GENERATION */
+
+    /*
+    * Generate a maze of a fixed size into a std::array, with a given prng state and policy.
+    *
+    * The function is constexpr, so a maze can be turned into a compile time constant:
+    * static constexpr auto level = mazelib::make_maze<16, 16, mazelib::blockwise> ( 1234, 25 );
+    *
+    * Called at runtime it returns the same bytes as the other generation functions.
+    * The result is width*height bytes for a compact maze, and ((width*2)+1)*((height*2)+1) bytes for a blockwise maze.
+    * If the policy returns an index out of range, the result is all zeros.
+    *
+    * Compilers limit how much work can be done in a constant expression, so this is meant for small mazes.
+    * With GCC and Clang the limits can be raised with -fconstexpr-ops-limit, -fconstexpr-loop-limit and -fconstexpr-steps.
+    */
+    template <uint32_t Width, uint32_t Height, class Format = compact, class Policy>
+    constexpr auto make_maze ( mazelib_prng prng, Policy policy )
+    {
+        static_assert ( Width > 0 && Height > 0, "A maze must be at least one cell in each direction" );
+        constexpr std::size_t area = ( std::size_t ) Width * Height;
+        std::array<uint8_t, area> grid {};
+        std::array<detail::cell_type_for_dimensions<Width, Height>, area> cells {};
+
+        const bool generated = detail::grow ( Width, Height, prng, policy, grid.data (), cells.data () ) != 0;
+        if constexpr ( Format::is_blockwise )
+        {
+            std::array < uint8_t, ( ( std::size_t ) Width * 2 + 1 ) * ( ( std::size_t ) Height * 2 + 1 ) > blocks {};
+            if ( generated )
+            {
+                detail::expand_to_blockwise ( Width, Height, grid.data (), blocks.data () );
+            }
+            return blocks;
+        }
+        else
+        {
+            if ( !generated )
+            {
+                grid = {};
+            }
+            return grid;
+        }
+    }
+
+    /* The compile time equivalent of mazelib_generate. The same seed and threshold give the same maze. */
+    template <uint32_t Width, uint32_t Height, class Format = compact>
+    constexpr auto make_maze ( uint64_t random_seed, int8_t random_threshold_percent )
+    {
+        mazelib_prng prng {};
+        seed ( prng, random_seed );
+        const threshold policy ( random_threshold_percent, prng );
+        return make_maze<Width, Height, Format> ( prng, policy );
+    }
+
+#endif
+
+#ifdef MAZELIB_HAS_COROUTINES
+
+    /* STEP BY STEP GENERATION */
+
+    /*
+    * A bump allocator over memory owned by the caller.
+    * Memory is only given back all at once, by reset or by discarding the arena together with its storage.
+    */
+    class arena
+    {
+    public:
+        arena ( void* data, std::size_t size ) : data_ ( static_cast<unsigned char*> ( data ) ), size_ ( size ), used_ ( 0 ) {}
+
+        arena ( const arena& ) = delete;
+        arena& operator= ( const arena& ) = delete;
+
+        /* Return a block of the given size and alignment, or nullptr if the arena is full. */
+        void* allocate ( std::size_t size, std::size_t alignment ) noexcept
+        {
+            const std::size_t address = reinterpret_cast<std::size_t> ( data_ + used_ );
+            const std::size_t padding = ( alignment - address % alignment ) % alignment;
+            if ( size_ - used_ < padding || size_ - used_ - padding < size )
+            {
+                return nullptr;
+            }
+            used_ += padding;
+            void* result = data_ + used_;
+            used_ += size;
+            return result;
+        }
+
+        void reset () noexcept
+        {
+            used_ = 0;
+        }
+
+        std::size_t used () const
+        {
+            return used_;
+        }
+
+    private:
+        unsigned char* data_;
+        std::size_t size_;
+        std::size_t used_;
+    };
+
+    /*
+    * A lazy sequence of carve events, produced by a coroutine.
+    *
+    * The coroutine is only resumed when the next event is requested, and runs just far enough to carve one more passage.
+    * The events can be pulled with next, or with a range based for loop.
+    * The coroutine frame is the only allocation, and it is made once when the sequence is created, from an arena if one was given.
+    */
+    class carve_generator
+    {
+    public:
+        struct promise_type
+        {
+            carve_event event {};
+            bool failed = false;
+
+            carve_generator get_return_object () noexcept
+            {
+                return carve_generator ( std::coroutine_handle<promise_type>::from_promise ( *this ) );
+            }
+            static carve_generator get_return_object_on_allocation_failure () noexcept
+            {
+                return carve_generator ( nullptr );
+            }
+            std::suspend_always initial_suspend () const noexcept
+            {
+                return {};
+            }
+            std::suspend_always final_suspend () const noexcept
+            {
+                return {};
+            }
+            std::suspend_always yield_value ( const carve_event& value ) noexcept
+            {
+                event = value;
+                return {};
+            }
+            void return_value ( bool succeeded ) noexcept
+            {
+                failed = !succeeded;
+            }
+            void unhandled_exception () noexcept
+            {
+                failed = true;
+            }
+
+            /*
+            * The frame is allocated from the arena passed as the first argument of the coroutine, or from the heap if that is nullptr.
+            * A small header in front of the frame records which of the two it was.
+            */
+            template <class... Args>
+            static void* operator new ( std::size_t size, arena* memory, Args&... ) noexcept
+            {
+                unsigned char* block;
+                if ( memory )
+                {
+                    block = static_cast<unsigned char*> ( memory->allocate ( size + header_size, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ) );
+                }
+                else
+                {
+                    block = static_cast<unsigned char*> ( ::operator new ( size + header_size, std::nothrow ) );
+                }
+                if ( block == nullptr )
+                {
+                    return nullptr;
+                }
+                *reinterpret_cast<arena**> ( block ) = memory;
+                return block + header_size;
+            }
+            static void operator delete ( void* frame, std::size_t ) noexcept
+            {
+                unsigned char* block = static_cast<unsigned char*> ( frame ) - header_size;
+                if ( *reinterpret_cast<arena**> ( block ) == nullptr )
+                {
+                    ::operator delete ( block );
+                }
+            }
+
+            static constexpr std::size_t header_size = __STDCPP_DEFAULT_NEW_ALIGNMENT__ > sizeof ( arena* ) ? __STDCPP_DEFAULT_NEW_ALIGNMENT__ : sizeof ( arena* );
+        };
+
+        class iterator
+        {
+        public:
+            using value_type = carve_event;
+            using difference_type = std::ptrdiff_t;
+
+            iterator () = default;
+            explicit iterator ( std::coroutine_handle<promise_type> handle ) : handle_ ( handle ) {}
+
+            const carve_event& operator* () const
+            {
+                return handle_.promise ().event;
+            }
+            const carve_event* operator-> () const
+            {
+                return &handle_.promise ().event;
+            }
+            iterator& operator++ ()
+            {
+                handle_.resume ();
+                return *this;
+            }
+            void operator++ ( int )
+            {
+                ++*this;
+            }
+            bool operator== ( std::default_sentinel_t ) const
+            {
+                return !handle_ || handle_.done ();
+            }
+
+        private:
+            std::coroutine_handle<promise_type> handle_;
+        };
+
+        carve_generator ( carve_generator&& other ) noexcept : handle_ ( other.handle_ )
+        {
+            other.handle_ = nullptr;
+        }
+        carve_generator& operator= ( carve_generator&& other ) noexcept
+        {
+            if ( this != &other )
+            {
+                if ( handle_ )
+                {
+                    handle_.destroy ();
+                }
+                handle_ = other.handle_;
+                other.handle_ = nullptr;
+            }
+            return *this;
+        }
+        ~carve_generator ()
+        {
+            if ( handle_ )
+            {
+                handle_.destroy ();
+            }
+        }
+
+        /* Returns false if the parameters were invalid or the coroutine frame could not be allocated. Such a sequence is empty. */
+        bool valid () const
+        {
+            return static_cast<bool> ( handle_ );
+        }
+
+        /* Carve the next passage. Returns false once the maze is complete. */
+        bool next ( carve_event& event )
+        {
+            if ( !handle_ || handle_.done () )
+            {
+                return false;
+            }
+            handle_.resume ();
+            if ( handle_.done () )
+            {
+                return false;
+            }
+            event = handle_.promise ().event;
+            return true;
+        }
+
+        /* Returns true if generation stopped because the policy returned an index out of range. */
+        bool failed () const
+        {
+            return handle_ && handle_.done () && handle_.promise ().failed;
+        }
+
+        iterator begin ()
+        {
+            if ( handle_ )
+            {
+                handle_.resume ();
+            }
+            return iterator ( handle_ );
+        }
+        std::default_sentinel_t end () const
+        {
+            return {};
+        }
+
+    private:
+        explicit carve_generator ( std::coroutine_handle<promise_type> handle ) : handle_ ( handle ) {}
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    namespace detail
+    {
+
+        template <class Policy, class Cell>
+        carve_generator carve_steps ( arena*, uint32_t width, uint32_t height, mazelib_prng& prng, Policy policy, uint8_t* grid, Cell* cells )
+        {
+            stepper<Policy, Cell> steps ( width, height, prng, policy, grid, cells );
+            carve_event event {};
+            while ( steps.next ( event ) )
+            {
+                co_yield event;
+            }
+            co_return !steps.failed ();
+        }
+
+    }
+
+    /*
+    * Generate a compact maze lazily, one carved passage at a time.
+    *
+    * output must hold at least mazelib_get_required_buffer_size ( width, height, 0 ) bytes, and is laid out like for mazelib_generate_extended.
+    * Once the sequence is exhausted, the first width*height bytes of output contain the same maze that mazelib::generate would have produced.
+    * The first event always starts from the initial cell, so that cell is never reported on its own.
+    *
+    * memory is an arena for the coroutine frame. If it is nullptr, the frame is allocated with operator new.
+    * The prng, the output buffer and the arena must outlive the returned sequence.
+    */
+    template <class Policy = newest>
+    carve_generator carve_steps ( arena* memory, span<uint8_t> output, uint32_t width, uint32_t height, mazelib_prng& prng, Policy policy = Policy () )
+    {
+        const uint64_t required_size = mazelib_get_required_buffer_size ( width, height, 0 );
+        const uint64_t area = ( uint64_t ) width * height;
+        uint8_t* grid = output.data ();
+
+        if ( required_size == 0 || grid == nullptr || output.size () < required_size )
+        {
+            return carve_generator::promise_type::get_return_object_on_allocation_failure ();
+        }
+        uint8_t* cells = grid + ( std::size_t ) area;
+        switch ( detail::cell_bytes_for_dimensions ( width, height ) )
+        {
+            case 1:
+                return detail::carve_steps ( memory, width, height, prng, policy, grid, reinterpret_cast<uint8_t*> ( cells ) );
+            case 2:
+                return detail::carve_steps ( memory, width, height, prng, policy, grid, reinterpret_cast<uint16_t*> ( cells ) );
+            case 4:
+                return detail::carve_steps ( memory, width, height, prng, policy, grid, reinterpret_cast<uint32_t*> ( cells ) );
+            default:
+                return detail::carve_steps ( memory, width, height, prng, policy, grid, reinterpret_cast<uint64_t*> ( cells ) );
+        }
+    }
+
+#endif
+
+    /* WORKSPACES */
+
+    /*
+    * A buffer which owns the storage for one maze of a fixed size, along with the temporary storage needed to generate it.
+    * The storage is allocated once by the constructor and released by the destructor, so a workspace can be reused for any number of mazes.
+    * Its size is the one given by required_buffer_size, which is mazelib_get_required_buffer_size with the automatic layout.
+    */
+    template <class Format = compact, class Layout = auto_layout, class Allocator = std::allocator<uint8_t>>
+    class workspace
+    {
+    public:
+        using view_type = typename Format::view_type;
+        using allocator_type = Allocator;
+
+        workspace ( uint32_t width, uint32_t height, const Allocator& allocator = Allocator () ) : buffer_ ( ( std::size_t ) required_buffer_size<Format, Layout> ( width, height ), allocator ), width_ ( width ), height_ ( height ), size_ ( 0 ) {}
+
+        uint32_t width () const
+        {
+            return width_;
+        }
+        uint32_t height () const
+        {
+            return height_;
+        }
+
+        /* The number of bytes used by the last generated maze, or 0 if none has been generated yet or the last attempt failed. */
+        uint64_t size () const
+        {
+            return size_;
+        }
+
+        allocator_type get_allocator () const
+        {
+            return buffer_.get_allocator ();
+        }
+
+        /* The whole underlying buffer, including the temporary storage. */
+        span<uint8_t> buffer ()
+        {
+            return span<uint8_t> ( buffer_.data (), buffer_.size () );
+        }
+
+        /* A typed view of the last generated maze. */
+        view_type view () const
+        {
+            return view_type ( span<const uint8_t> ( buffer_.data (), ( std::size_t ) size_ ), width_, height_ );
+        }
+
+        /* Generate a maze into this workspace, see mazelib::generate. */
+        template <class Policy = newest>
+        uint64_t generate ( mazelib_prng& prng, Policy policy = Policy () )
+        {
+            size_ = mazelib::generate<Policy, Format, Layout> ( buffer (), width_, height_, prng, policy );
+            return size_;
+        }
+
+    private:
+        std::vector<uint8_t, Allocator> buffer_;
+        uint32_t width_;
+        uint32_t height_;
+        uint64_t size_;
+    };
+
+    /* DISTANCES */
+
+    /* The temporary storage used by the solving functions, which can be reused between calls for mazes of up to the same number of cells. */
+    template <class Allocator = std::allocator<uint32_t>>
+    class basic_solver_scratch
+    {
+    public:
+        using allocator_type = Allocator;
+
+        basic_solver_scratch ( uint32_t width, uint32_t height, const Allocator& allocator = Allocator () ) : queue_ ( ( std::size_t ) width * height, allocator ) {}
+
+        allocator_type get_allocator () const
+        {
+            return queue_.get_allocator ();
+        }
+
+        /* The number of cells this scratch space can handle. */
+        std::size_t capacity () const
+        {
+            return queue_.size ();
+        }
+
+        uint32_t* data ()
+        {
+            return queue_.data ();
+        }
+
+    private:
+        std::vector<uint32_t, Allocator> queue_;
+    };
+
+    /* The distance from one cell to every other cell of a compact maze, as computed by mazelib_get_distances. */
+    template <class Allocator = std::allocator<uint32_t>>
+    class basic_distance_map
+    {
+    public:
+        using allocator_type = Allocator;
+
+        basic_distance_map ( uint32_t width, uint32_t height, const Allocator& allocator = Allocator () ) : distances_ ( ( std::size_t ) width * height, mazelib_unreachable, allocator ), width_ ( width ), height_ ( height ), reachable_ ( 0 ) {}
+
+        /*
+        * Measure the distances in maze from the cell at x, y. The maze must have the same dimensions as the map.
+        * Returns the number of reachable cells, or 0 if the parameters were invalid.
+        */
+        template <class ScratchAllocator>
+        uint64_t compute ( const compact_view& maze, uint32_t x, uint32_t y, basic_solver_scratch<ScratchAllocator>& scratch )
+        {
+            reachable_ = 0;
+            if ( maze.width () != width_ || maze.height () != height_ || maze.data ().size () < distances_.size () || scratch.capacity () < distances_.size () )
+            {
+                return 0;
+            }
+            reachable_ = mazelib_get_distances ( width_, height_, maze.data ().data (), x, y, distances_.data (), scratch.data () );
+            return reachable_;
+        }
+
+        /* Measure the distances with temporary scratch space taken from the allocator of this map. */
+        uint64_t compute ( const compact_view& maze, uint32_t x, uint32_t y )
+        {
+            basic_solver_scratch<Allocator> scratch ( width_, height_, distances_.get_allocator () );
+            return compute ( maze, x, y, scratch );
+        }
+
+        allocator_type get_allocator () const
+        {
+            return distances_.get_allocator ();
+        }
+
+        uint32_t width () const
+        {
+            return width_;
+        }
+        uint32_t height () const
+        {
+            return height_;
+        }
+
+        /* The number of cells that were reachable in the last call to compute. */
+        uint64_t reachable () const
+        {
+            return reachable_;
+        }
+
+        /* The number of steps to the given cell, or mazelib_unreachable. */
+        uint32_t operator() ( uint32_t x, uint32_t y ) const
+        {
+            return distances_[( std::size_t ) x * height_ + y];
+        }
+
+        span<const uint32_t> data () const
+        {
+            return span<const uint32_t> ( distances_.data (), distances_.size () );
+        }
+
+    private:
+        std::vector<uint32_t, Allocator> distances_;
+        uint32_t width_;
+        uint32_t height_;
+        uint64_t reachable_;
+    };
+
+    using solver_scratch = basic_solver_scratch<>;
+    using distance_map = basic_distance_map<>;
+
+#ifdef MAZELIB_HAS_MEMORY_RESOURCE
+
+    /*
+    * The same types with polymorphic allocators.
+    * Pass a std::pmr::memory_resource* as the last constructor argument, for example a std::pmr::monotonic_buffer_resource per request,
+    * and everything can be released at once by releasing the resource.
+    */
+    namespace pmr
+    {
+        template <class Format = compact, class Layout = auto_layout>
+        using maze = workspace<Format, Layout, std::pmr::polymorphic_allocator<uint8_t>>;
+        using solver_scratch = basic_solver_scratch<std::pmr::polymorphic_allocator<uint32_t>>;
+        using distance_map = basic_distance_map<std::pmr::polymorphic_allocator<uint32_t>>;
+    }
+
+#endif
+
+}
+
+#endif  /* MAZELIB_HPP */
@@ -0,0 +1,704 @@
+/*
+* Python bindings for mazelib.
+*
+* Build with "python setup.py build_ext --inplace" (or pip install .) from this directory.
+*
+* Mazes and the results of the analysis functions are returned as mazelib.Array objects, which own their memory and expose it through the buffer protocol,
+* so memoryview(array) and numpy.asarray(array) see the same bytes without copying. A maze in the compact format has the shape (width, height),
+* so maze[x][y] is the cell at x, y, and a blockwise maze has the shape (width*2+1, height*2+1).
+* Any C contiguous two dimensional buffer of unsigned bytes (such as a numpy uint8 array) is accepted as a maze in the compact format.
+*
+* The global interpreter lock is released while the library works, so several threads can generate or analyse mazes at the same time.
+* The only exception is generation with a Python selection function, which has to hold the lock to call it.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define MAZELIB_IMPLEMENTATION
+#include "mazelib.h"
+
+/* ARRAY TYPE */
+
+typedef struct mazelib_array mazelib_array;
+struct mazelib_array
+{
+    PyObject_HEAD
+    void* data;
+    const char* format;
+    Py_ssize_t itemsize;
+    int ndim;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+};
+
+static int mazelib_array_getbuffer ( PyObject* self, Py_buffer* view, int flags )
+{
+    mazelib_array* array = ( mazelib_array* ) self;
+    Py_ssize_t length = array->itemsize;
+    int i;
+
+    for ( i = 0; i < array->ndim; ++i )
+    {
+        length *= array->shape[i];
+    }
+
+    view->obj = self;
+    view->buf = array->data;
+    view->len = length;
+    view->readonly = 0;
+    view->itemsize = array->itemsize;
+    view->format = ( flags & PyBUF_FORMAT ) ? ( char* ) array->format : NULL;
+    view->ndim = array->ndim;
+    view->shape = ( flags & PyBUF_ND ) == PyBUF_ND ? array->shape : NULL;
+    view->strides = ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ? array->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    Py_INCREF ( self );
+    return 0;
+}
+
+static void mazelib_array_dealloc ( PyObject* self )
+{
+    PyMem_Free ( ( ( mazelib_array* ) self )->data );
+    Py_TYPE ( self )->tp_free ( self );
+}
+
+static PyBufferProcs mazelib_array_buffer_procs =
+{
+    mazelib_array_getbuffer,
+    NULL
+};
+
+static PyTypeObject mazelib_array_type =
+{
+    PyVarObject_HEAD_INIT ( NULL, 0 )
+    "mazelib.Array",
+};
+
+/*
+* Create an array of the given element type and shape, with room for at least capacity bytes.
+* The generator needs room for its list of cells on top of the maze itself, and the caller can shrink the array afterwards with mazelib_array_shrink.
+*/
+static mazelib_array* mazelib_array_new ( const char* format, Py_ssize_t itemsize, int ndim, const Py_ssize_t* shape, uint64_t capacity )
+{
+    mazelib_array* array;
+    uint64_t length = ( uint64_t ) itemsize;
+    int i;
+
+    for ( i = 0; i < ndim; ++i )
+    {
+        length *= ( uint64_t ) shape[i];
+    }
+    if ( capacity < length )
+    {
+        capacity = length;
+    }
+    if ( capacity > ( uint64_t ) PY_SSIZE_T_MAX )
+    {
+        PyErr_NoMemory ();
+        return NULL;
+    }
+
+    array = PyObject_New ( mazelib_array, &mazelib_array_type );
+    if ( array == NULL )
+    {
+        return NULL;
+    }
+    array->data = PyMem_Malloc ( capacity ? ( size_t ) capacity : 1 );
+    if ( array->data == NULL )
+    {
+        array->format = NULL;
+        Py_DECREF ( array );
+        PyErr_NoMemory ();
+        return NULL;
+    }
+    array->format = format;
+    array->itemsize = itemsize;
+    array->ndim = ndim;
+    for ( i = ndim - 1; i >= 0; --i )
+    {
+        array->shape[i] = shape[i];
+        array->strides[i] = i == ndim - 1 ? itemsize : array->strides[i + 1] * shape[i + 1];
+    }
+    return array;
+}
+
+/* Give back the memory beyond the elements of an array which has not been exported yet. Failing to do so is harmless. */
+static void mazelib_array_shrink ( mazelib_array* array, uint64_t length )
+{
+    void* data = PyMem_Realloc ( array->data, length ? ( size_t ) length : 1 );
+    if ( data != NULL )
+    {
+        array->data = data;
+    }
+}
+
+/* ARGUMENT HANDLING */
+
+/* Get a maze in the compact format from any two dimensional, C contiguous buffer of bytes. Raises an exception and returns 0 on failure. */
+static int mazelib_get_grid ( PyObject* object, Py_buffer* view, uint32_t* width, uint32_t* height )
+{
+    if ( PyObject_GetBuffer ( object, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT ) != 0 )
+    {
+        return 0;
+    }
+    if ( view->ndim != 2 || view->itemsize != 1 || ( view->format != NULL && strcmp ( view->format, "B" ) != 0 ) )
+    {
+        PyBuffer_Release ( view );
+        PyErr_SetString ( PyExc_ValueError, "a maze must be a two dimensional array of unsigned bytes with the shape (width, height)" );
+        return 0;
+    }
+    if ( view->shape[0] <= 0 || view->shape[1] <= 0 || view->shape[0] > 0xffffffff || view->shape[1] > 0xffffffff )
+    {
+        PyBuffer_Release ( view );
+        PyErr_SetString ( PyExc_ValueError, "invalid maze dimensions" );
+        return 0;
+    }
+    *width = ( uint32_t ) view->shape[0];
+    *height = ( uint32_t ) view->shape[1];
+    return 1;
+}
+
+/* GENERATION */
+
+/* The state for a selection function written in Python. The lock is held throughout, since the function is called at every step. */
+typedef struct mazelib_python_selection mazelib_python_selection;
+struct mazelib_python_selection
+{
+    PyObject* function;
+    int failed;
+};
+
+static uint64_t mazelib_python_selection_callback ( uint64_t count, mazelib_prng* prng, void* user )
+{
+    mazelib_python_selection* selection = ( mazelib_python_selection* ) user;
+    PyObject* result;
+    unsigned long long index;
+
+    ( void ) prng;
+    result = PyObject_CallFunction ( selection->function, "K", ( unsigned long long ) count );
+    if ( result == NULL )
+    {
+        selection->failed = 1;
+        return count;
+    }
+    index = PyLong_AsUnsignedLongLong ( result );
+    Py_DECREF ( result );
+    if ( PyErr_Occurred () )
+    {
+        selection->failed = 1;
+        return count;
+    }
+    return ( uint64_t ) index;
+}
+
+PyDoc_STRVAR ( mazelib_py_generate_doc,
+               "generate(width, height, seed, threshold=-1, blockwise=False, select=None, out=None)\n"
+               "\n"
+               "Generate a maze with mazelib_generate_extended.\n"
+               "\n"
+               "threshold is the chance in percent of backtracking to a random cell instead of the newest one, as for mazelib_generate (-1 picks one at random).\n"
+               "select, if given, replaces the threshold with a function which receives the number of cells in the list and returns the index of the one to continue from.\n"
+               "It is called at every step with the interpreter lock held, so it is much slower.\n"
+               "\n"
+               "Returns a new Array, or if out is given, generates into that writable buffer (which needs required_buffer_size bytes) and returns the number of bytes of it used by the maze." );
+
+static PyObject* mazelib_py_generate ( PyObject* module, PyObject* args, PyObject* kwargs )
+{
+    static char* keywords[] = { "width", "height", "seed", "threshold", "blockwise", "select", "out", NULL };
+    unsigned int width, height;
+    unsigned long long seed;
+    int threshold = -1;
+    int blockwise = 0;
+    PyObject* select = Py_None;
+    PyObject* out = Py_None;
+    mazelib_array* array = NULL;
+    Py_buffer view;
+    uint8_t* output;
+    uint64_t required_size, output_size, result;
+    mazelib_prng prng;
+    int8_t random_threshold_percent;
+    mazelib_python_selection selection;
+
+    ( void ) module;
+    if ( !PyArg_ParseTupleAndKeywords ( args, kwargs, "IIK|ipOO", keywords, &width, &height, &seed, &threshold, &blockwise, &select, &out ) )
+    {
+        return NULL;
+    }
+    if ( select != Py_None && !PyCallable_Check ( select ) )
+    {
+        PyErr_SetString ( PyExc_TypeError, "select must be callable" );
+        return NULL;
+    }
+    required_size = mazelib_get_required_buffer_size ( width, height, ( uint8_t ) blockwise );
+    if ( required_size == 0 )
+    {
+        PyErr_SetString ( PyExc_ValueError, "invalid maze dimensions" );
+        return NULL;
+    }
+
+    if ( out != Py_None )
+    {
+        if ( PyObject_GetBuffer ( out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS ) != 0 )
+        {
+            return NULL;
+        }
+        if ( ( uint64_t ) view.len < required_size )
+        {
+            PyBuffer_Release ( &view );
+            PyErr_Format ( PyExc_ValueError, "out needs at least %llu bytes", ( unsigned long long ) required_size );
+            return NULL;
+        }
+        output = ( uint8_t* ) view.buf;
+        output_size = ( uint64_t ) view.len;
+    }
+    else
+    {
+        Py_ssize_t shape[2];
+        shape[0] = blockwise ? ( Py_ssize_t ) width * 2 + 1 : ( Py_ssize_t ) width;
+        shape[1] = blockwise ? ( Py_ssize_t ) height * 2 + 1 : ( Py_ssize_t ) height;
+        array = mazelib_array_new ( "B", 1, 2, shape, required_size );
+        if ( array == NULL )
+        {
+            return NULL;
+        }
+        output = ( uint8_t* ) array->data;
+        output_size = required_size;
+    }
+
+    /* Resolve the threshold the same way as mazelib_generate, so that the same seed gives the same maze. */
+    mazelib_prng_seed ( &prng, ( uint64_t ) seed );
+    if ( threshold < 0 )
+    {
+        random_threshold_percent = ( int8_t ) mazelib_prng_next_in_range ( &prng, 101 );
+    }
+    else
+    {
+        random_threshold_percent = ( int8_t ) ( threshold > 100 ? 100 : threshold );
+    }
+
+    if ( select != Py_None )
+    {
+        selection.function = select;
+        selection.failed = 0;
+        result = mazelib_generate_extended ( width, height, &prng, mazelib_python_selection_callback, ( void* ) &selection, ( uint8_t ) blockwise, output, output_size );
+    }
+    else
+    {
+        selection.failed = 0;
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_generate_extended ( width, height, &prng, mazelib_high_level_cell_selection_callback, ( void* ) &random_threshold_percent, ( uint8_t ) blockwise, output, output_size );
+        Py_END_ALLOW_THREADS
+    }
+
+    if ( out != Py_None )
+    {
+        PyBuffer_Release ( &view );
+    }
+    if ( result == 0 )
+    {
+        Py_XDECREF ( array );
+        if ( !selection.failed )
+        {
+            PyErr_SetString ( PyExc_ValueError, "generation failed (the selection function returned an index out of range)" );
+        }
+        return NULL;
+    }
+    if ( array == NULL )
+    {
+        return PyLong_FromUnsignedLongLong ( ( unsigned long long ) result );
+    }
+    mazelib_array_shrink ( array, result );
+    return ( PyObject* ) array;
+}
+
+PyDoc_STRVAR ( mazelib_py_required_buffer_size_doc,
+               "required_buffer_size(width, height, blockwise=False)\n"
+               "\n"
+               "The size of the buffer to pass as out to generate." );
+
+static PyObject* mazelib_py_required_buffer_size ( PyObject* module, PyObject* args, PyObject* kwargs )
+{
+    static char* keywords[] = { "width", "height", "blockwise", NULL };
+    unsigned int width, height;
+    int blockwise = 0;
+
+    ( void ) module;
+    if ( !PyArg_ParseTupleAndKeywords ( args, kwargs, "II|p", keywords, &width, &height, &blockwise ) )
+    {
+        return NULL;
+    }
+    return PyLong_FromUnsignedLongLong ( ( unsigned long long ) mazelib_get_required_buffer_size ( width, height, ( uint8_t ) blockwise ) );
+}
+
+PyDoc_STRVAR ( mazelib_py_to_blockwise_doc,
+               "to_blockwise(maze, path=None)\n"
+               "\n"
+               "Convert a maze in the compact format to a new blockwise Array.\n"
+               "If path is given, it is a buffer with a bit for every cell (as filled in by mark_path), and the path is drawn with the value path_block." );
+
+static PyObject* mazelib_py_to_blockwise ( PyObject* module, PyObject* args, PyObject* kwargs )
+{
+    static char* keywords[] = { "maze", "path", NULL };
+    PyObject* maze;
+    PyObject* path = Py_None;
+    Py_buffer grid, bits;
+    uint32_t width, height;
+    mazelib_array* array;
+    Py_ssize_t shape[2];
+    uint64_t result;
+
+    ( void ) module;
+    if ( !PyArg_ParseTupleAndKeywords ( args, kwargs, "O|O", keywords, &maze, &path ) )
+    {
+        return NULL;
+    }
+    if ( !mazelib_get_grid ( maze, &grid, &width, &height ) )
+    {
+        return NULL;
+    }
+    if ( path != Py_None )
+    {
+        if ( PyObject_GetBuffer ( path, &bits, PyBUF_C_CONTIGUOUS ) != 0 )
+        {
+            PyBuffer_Release ( &grid );
+            return NULL;
+        }
+        if ( ( uint64_t ) bits.len < ( ( uint64_t ) width * height + 7 ) / 8 )
+        {
+            PyBuffer_Release ( &bits );
+            PyBuffer_Release ( &grid );
+            PyErr_SetString ( PyExc_ValueError, "path needs a bit for every cell" );
+            return NULL;
+        }
+    }
+
+    shape[0] = ( Py_ssize_t ) width * 2 + 1;
+    shape[1] = ( Py_ssize_t ) height * 2 + 1;
+    array = mazelib_array_new ( "B", 1, 2, shape, 0 );
+    if ( array != NULL )
+    {
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_convert_to_blockwise_with_path ( width, height, ( const uint8_t* ) grid.buf, path != Py_None ? ( const uint8_t* ) bits.buf : NULL, ( uint8_t* ) array->data, ( uint64_t ) shape[0] * ( uint64_t ) shape[1] );
+        Py_END_ALLOW_THREADS
+        ( void ) result;
+    }
+
+    if ( path != Py_None )
+    {
+        PyBuffer_Release ( &bits );
+    }
+    PyBuffer_Release ( &grid );
+    return ( PyObject* ) array;
+}
+
+/* ANALYSIS */
+
+PyDoc_STRVAR ( mazelib_py_distances_doc,
+               "distances(maze, x, y)\n"
+               "\n"
+               "Return an Array of uint32 with the shape of the maze, holding the number of steps from x, y to every cell (unreachable for cells that can not be reached)." );
+
+static PyObject* mazelib_py_distances ( PyObject* module, PyObject* args )
+{
+    PyObject* maze;
+    unsigned int x, y;
+    Py_buffer grid;
+    uint32_t width, height;
+    uint32_t* scratch;
+    mazelib_array* array;
+    Py_ssize_t shape[2];
+    uint64_t result = 0;
+
+    ( void ) module;
+    if ( !PyArg_ParseTuple ( args, "OII", &maze, &x, &y ) || !mazelib_get_grid ( maze, &grid, &width, &height ) )
+    {
+        return NULL;
+    }
+    shape[0] = width;
+    shape[1] = height;
+    array = mazelib_array_new ( "I", 4, 2, shape, 0 );
+    scratch = ( uint32_t* ) PyMem_Malloc ( ( size_t ) width * height * sizeof ( uint32_t ) );
+    if ( array != NULL && scratch != NULL )
+    {
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_get_distances ( width, height, ( const uint8_t* ) grid.buf, x, y, ( uint32_t* ) array->data, scratch );
+        Py_END_ALLOW_THREADS
+    }
+    PyMem_Free ( scratch );
+    PyBuffer_Release ( &grid );
+
+    if ( array == NULL || scratch == NULL )
+    {
+        Py_XDECREF ( array );
+        return array == NULL ? NULL : PyErr_NoMemory ();
+    }
+    if ( result == 0 )
+    {
+        Py_DECREF ( array );
+        PyErr_SetString ( PyExc_ValueError, "invalid start cell or maze" );
+        return NULL;
+    }
+    return ( PyObject* ) array;
+}
+
+PyDoc_STRVAR ( mazelib_py_mark_path_doc,
+               "mark_path(maze, distances, x, y)\n"
+               "\n"
+               "Return a bytearray with a bit for every cell, marking a shortest path from the start of distances to x, y, for to_blockwise." );
+
+static PyObject* mazelib_py_mark_path ( PyObject* module, PyObject* args )
+{
+    PyObject* maze;
+    PyObject* distances_object;
+    PyObject* path;
+    unsigned int x, y;
+    Py_buffer grid, distances;
+    uint32_t width, height;
+    uint64_t result = 0;
+
+    ( void ) module;
+    if ( !PyArg_ParseTuple ( args, "OOII", &maze, &distances_object, &x, &y ) || !mazelib_get_grid ( maze, &grid, &width, &height ) )
+    {
+        return NULL;
+    }
+    if ( PyObject_GetBuffer ( distances_object, &distances, PyBUF_C_CONTIGUOUS ) != 0 )
+    {
+        PyBuffer_Release ( &grid );
+        return NULL;
+    }
+    path = ( uint64_t ) distances.len < ( uint64_t ) width * height * 4 ? NULL : PyByteArray_FromStringAndSize ( NULL, ( Py_ssize_t ) ( ( ( uint64_t ) width * height + 7 ) / 8 ) );
+    if ( path != NULL )
+    {
+        uint8_t* bits = ( uint8_t* ) PyByteArray_AS_STRING ( path );
+        memset ( bits, 0, ( size_t ) PyByteArray_GET_SIZE ( path ) );
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_mark_path ( width, height, ( const uint8_t* ) grid.buf, ( const uint32_t* ) distances.buf, x, y, bits );
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release ( &distances );
+    PyBuffer_Release ( &grid );
+
+    if ( path != NULL && result == 0 )
+    {
+        Py_CLEAR ( path );
+    }
+    if ( path == NULL && !PyErr_Occurred () )
+    {
+        PyErr_SetString ( PyExc_ValueError, "the cell can not be reached, or distances does not belong to the maze" );
+    }
+    return path;
+}
+
+PyDoc_STRVAR ( mazelib_py_label_components_doc,
+               "label_components(maze)\n"
+               "\n"
+               "Return (labels, sizes): an Array of uint32 with the component of every cell, and a one dimensional Array of uint32 with the size of each component." );
+
+static PyObject* mazelib_py_label_components ( PyObject* module, PyObject* maze )
+{
+    Py_buffer grid;
+    uint32_t width, height;
+    mazelib_array* labels;
+    mazelib_array* sizes;
+    Py_ssize_t shape[2];
+    uint64_t result = 0;
+
+    ( void ) module;
+    if ( !mazelib_get_grid ( maze, &grid, &width, &height ) )
+    {
+        return NULL;
+    }
+    shape[0] = width;
+    shape[1] = height;
+    labels = mazelib_array_new ( "I", 4, 2, shape, 0 );
+    shape[0] = ( Py_ssize_t ) width * height;
+    sizes = labels == NULL ? NULL : mazelib_array_new ( "I", 4, 1, shape, 0 );
+    if ( sizes != NULL )
+    {
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_label_components ( width, height, ( const uint8_t* ) grid.buf, ( uint32_t* ) labels->data, ( uint32_t* ) sizes->data );
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release ( &grid );
+
+    if ( result == 0 )
+    {
+        Py_XDECREF ( labels );
+        Py_XDECREF ( sizes );
+        if ( !PyErr_Occurred () )
+        {
+            PyErr_SetString ( PyExc_ValueError, "the maze is too large" );
+        }
+        return NULL;
+    }
+    sizes->shape[0] = ( Py_ssize_t ) result;
+    mazelib_array_shrink ( sizes, result * 4 );
+    return Py_BuildValue ( "(NN)", labels, sizes );
+}
+
+PyDoc_STRVAR ( mazelib_py_tree_betweenness_doc,
+               "tree_betweenness(maze)\n"
+               "\n"
+               "Return (passages, cells): Arrays of uint64 with the shapes (width, height, 2) and (width, height).\n"
+               "passages[x][y][0] is the betweenness of the passage to the east of x, y and passages[x][y][1] that of the passage to the south.\n"
+               "Raises ValueError if the maze is not perfect." );
+
+static PyObject* mazelib_py_tree_betweenness ( PyObject* module, PyObject* maze )
+{
+    Py_buffer grid;
+    uint32_t width, height;
+    mazelib_array* passages;
+    mazelib_array* cells;
+    uint32_t* scratch;
+    Py_ssize_t shape[3];
+    uint64_t result = 0;
+
+    ( void ) module;
+    if ( !mazelib_get_grid ( maze, &grid, &width, &height ) )
+    {
+        return NULL;
+    }
+    shape[0] = width;
+    shape[1] = height;
+    shape[2] = 2;
+    passages = mazelib_array_new ( "Q", 8, 3, shape, 0 );
+    cells = passages == NULL ? NULL : mazelib_array_new ( "Q", 8, 2, shape, 0 );
+    scratch = cells == NULL ? NULL : ( uint32_t* ) PyMem_Malloc ( ( size_t ) width * height * 3 * sizeof ( uint32_t ) );
+    if ( scratch != NULL )
+    {
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_get_tree_betweenness ( width, height, ( const uint8_t* ) grid.buf, ( uint64_t* ) passages->data, ( uint64_t* ) cells->data, scratch );
+        Py_END_ALLOW_THREADS
+        PyMem_Free ( scratch );
+    }
+    else if ( cells != NULL )
+    {
+        PyErr_NoMemory ();
+    }
+    PyBuffer_Release ( &grid );
+
+    if ( result == 0 )
+    {
+        Py_XDECREF ( passages );
+        Py_XDECREF ( cells );
+        if ( !PyErr_Occurred () )
+        {
+            PyErr_SetString ( PyExc_ValueError, "the maze is not perfect, or too large" );
+        }
+        return NULL;
+    }
+    return Py_BuildValue ( "(NN)", passages, cells );
+}
+
+PyDoc_STRVAR ( mazelib_py_chokepoints_doc,
+               "chokepoints(maze)\n"
+               "\n"
+               "Return (articulation_points, bridges): Arrays of bytes with the shape of the maze.\n"
+               "articulation_points holds 1 for every cell whose removal would cut the maze, and bridges is a maze in the compact format with only the bridges." );
+
+static PyObject* mazelib_py_chokepoints ( PyObject* module, PyObject* maze )
+{
+    Py_buffer grid;
+    uint32_t width, height;
+    mazelib_array* articulation_points;
+    mazelib_array* bridges;
+    uint32_t* scratch;
+    Py_ssize_t shape[2];
+    uint64_t result = 0;
+
+    ( void ) module;
+    if ( !mazelib_get_grid ( maze, &grid, &width, &height ) )
+    {
+        return NULL;
+    }
+    shape[0] = width;
+    shape[1] = height;
+    articulation_points = mazelib_array_new ( "B", 1, 2, shape, 0 );
+    bridges = articulation_points == NULL ? NULL : mazelib_array_new ( "B", 1, 2, shape, 0 );
+    scratch = bridges == NULL ? NULL : ( uint32_t* ) PyMem_Malloc ( ( size_t ) width * height * 3 * sizeof ( uint32_t ) );
+    if ( scratch != NULL )
+    {
+        Py_BEGIN_ALLOW_THREADS
+        result = mazelib_get_chokepoints ( width, height, ( const uint8_t* ) grid.buf, ( uint8_t* ) articulation_points->data, ( uint8_t* ) bridges->data, scratch );
+        Py_END_ALLOW_THREADS
+        PyMem_Free ( scratch );
+    }
+    else if ( bridges != NULL )
+    {
+        PyErr_NoMemory ();
+    }
+    PyBuffer_Release ( &grid );
+
+    if ( result == 0 )
+    {
+        Py_XDECREF ( articulation_points );
+        Py_XDECREF ( bridges );
+        if ( !PyErr_Occurred () )
+        {
+            PyErr_SetString ( PyExc_ValueError, "the maze is too large" );
+        }
+        return NULL;
+    }
+    return Py_BuildValue ( "(NN)", articulation_points, bridges );
+}
+
+/* MODULE */
+
+static PyMethodDef mazelib_methods[] =
+{
+    { "generate", ( PyCFunction ) ( void ( * ) ( void ) ) mazelib_py_generate, METH_VARARGS | METH_KEYWORDS, mazelib_py_generate_doc },
+    { "required_buffer_size", ( PyCFunction ) ( void ( * ) ( void ) ) mazelib_py_required_buffer_size, METH_VARARGS | METH_KEYWORDS, mazelib_py_required_buffer_size_doc },
+    { "to_blockwise", ( PyCFunction ) ( void ( * ) ( void ) ) mazelib_py_to_blockwise, METH_VARARGS | METH_KEYWORDS, mazelib_py_to_blockwise_doc },
+    { "distances", mazelib_py_distances, METH_VARARGS, mazelib_py_distances_doc },
+    { "mark_path", mazelib_py_mark_path, METH_VARARGS, mazelib_py_mark_path_doc },
+    { "label_components", mazelib_py_label_components, METH_O, mazelib_py_label_components_doc },
+    { "tree_betweenness", mazelib_py_tree_betweenness, METH_O, mazelib_py_tree_betweenness_doc },
+    { "chokepoints", mazelib_py_chokepoints, METH_O, mazelib_py_chokepoints_doc },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef mazelib_module =
+{
+    PyModuleDef_HEAD_INIT,
+    "mazelib",
+    "Maze generation and analysis with mazelib. Results are Array objects which support the buffer protocol, so numpy.asarray uses them without copying.",
+    -1,
+    mazelib_methods
+};
+
+PyMODINIT_FUNC PyInit_mazelib ( void )
+{
+    PyObject* module;
+
+    mazelib_array_type.tp_basicsize = sizeof ( mazelib_array );
+    mazelib_array_type.tp_dealloc = mazelib_array_dealloc;
+    mazelib_array_type.tp_as_buffer = &mazelib_array_buffer_procs;
+    mazelib_array_type.tp_flags = Py_TPFLAGS_DEFAULT;
+    mazelib_array_type.tp_doc = "Memory owned by mazelib, exposed through the buffer protocol. Use memoryview or numpy.asarray to read it.";
+    if ( PyType_Ready ( &mazelib_array_type ) < 0 )
+    {
+        return NULL;
+    }
+
+    module = PyModule_Create ( &mazelib_module );
+    if ( module == NULL )
+    {
+        return NULL;
+    }
+    Py_INCREF ( &mazelib_array_type );
+    if ( PyModule_AddObject ( module, "Array", ( PyObject* ) &mazelib_array_type ) < 0 )
+    {
+        Py_DECREF ( &mazelib_array_type );
+        Py_DECREF ( module );
+        return NULL;
+    }
+    PyModule_AddIntConstant ( module, "west", mazelib_west );
+    PyModule_AddIntConstant ( module, "east", mazelib_east );
+    PyModule_AddIntConstant ( module, "north", mazelib_north );
+    PyModule_AddIntConstant ( module, "south", mazelib_south );
+    PyModule_AddIntConstant ( module, "path_block", mazelib_path_block );
+    PyModule_AddObject ( module, "unreachable", PyLong_FromUnsignedLong ( mazelib_unreachable ) );
+    return module;
+}
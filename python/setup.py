@@ -0,0 +1,19 @@
+# Build the Python bindings for mazelib with "python setup.py build_ext --inplace" or "pip install ." from this directory.
+import os
+from setuptools import setup, Extension
+
+root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+setup(
+    name="mazelib",
+    version="1.1",
+    description="Python bindings for mazelib, with results exposed through the buffer protocol",
+    license="MIT-0 OR Unlicense",
+    ext_modules=[
+        Extension(
+            "mazelib",
+            sources=["mazelibmodule.c"],
+            include_dirs=[root],
+        )
+    ],
+)